@@ -0,0 +1,142 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+
+#include "../include/graph_utils/graph_utils.h"
+#include "../include/request_server/request_server.h"
+
+using namespace std::chrono;
+
+
+/** globals **/
+
+std::vector<double> latencies; // milliseconds
+std::mutex latenciesMutex;
+unsigned long long failed = 0;
+
+
+/** functions **/
+
+// Same generator of randomize_source_dest, without printing every pair
+void next_source_dest(unsigned long &seed, unsigned long nodes, NodeId &source, NodeId &dest) {
+	unsigned long r1 = (seed * LCG_MULTIPLIER + LCG_INCREMENT) % nodes;
+	unsigned long r2 = (r1 * LCG_MULTIPLIER + LCG_INCREMENT) % nodes;
+	source = r1;
+	dest = r2;
+	seed = r2;
+}
+
+// Send nRequests random queries on a new connection, keeping up to window of them in flight
+void run_connection(const std::string &address, unsigned long seed, unsigned int nRequests, unsigned int window) {
+	int fd = connect_address(address);
+	if (fd < 0)
+		return;
+	line_reader reader(fd);
+	std::string line, word;
+	unsigned long nodes = 0;
+	if (!reader.next(line) || !(std::istringstream(line) >> word >> nodes) || word != "NODES" || nodes == 0) {
+		std::cerr << "Invalid greeting from the server: " << line << std::endl;
+		close(fd);
+		return;
+	}
+
+	std::unordered_map<unsigned int, high_resolution_clock::time_point> inFlight;
+	std::vector<double> localLatencies;
+	unsigned long long localFailed = 0;
+	unsigned int sent = 0, received = 0;
+	NodeId source, dest;
+	while (received < nRequests) {
+		// fill the window
+		std::string out;
+		while (sent < nRequests && inFlight.size() < window) {
+			next_source_dest(seed, nodes, source, dest);
+			inFlight[sent] = high_resolution_clock::now();
+			out += std::to_string(sent) + " " + std::to_string(source) + " " + std::to_string(dest) + "\n";
+			sent++;
+		}
+		if (!out.empty() && !write_all(fd, out))
+			break;
+
+		if (!reader.next(line))
+			break;
+		unsigned int id;
+		double cost;
+		if (!(std::istringstream(line) >> id >> cost) || !inFlight.contains(id)) {
+			std::cerr << "Invalid response: " << line << std::endl;
+			break;
+		}
+		localLatencies.push_back(duration<double, std::milli>(high_resolution_clock::now() - inFlight[id]).count());
+		if (cost < 0)
+			localFailed++;
+		inFlight.erase(id);
+		received++;
+	}
+	close(fd);
+
+	std::unique_lock lock(latenciesMutex);
+	latencies.insert(latencies.end(), localLatencies.begin(), localLatencies.end());
+	failed += localFailed;
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+	if (sorted.empty())
+		return 0;
+	return sorted[std::min(sorted.size() - 1, (size_t) (p / 100 * sorted.size()))];
+}
+
+int main(int argc, char *argv[]) {
+	// print usage
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " ADDRESS STARTING_SEED [N_REQUESTS=1000] [N_CONNECTIONS=4] [WINDOW=8]"
+		          << std::endl;
+		return 1;
+	}
+
+	// parse command line parameters
+	std::string address = argv[1];
+	unsigned long seed;
+	unsigned int nRequests = 1000;
+	unsigned int nConnections = 4;
+	unsigned int window = 8;
+	try {
+		seed = std::stoul(argv[2]);
+		if (argc >= 4)
+			nRequests = std::stoul(argv[3]);
+		if (argc >= 5)
+			nConnections = std::stoul(argv[4]);
+		if (argc >= 6)
+			window = std::max(1ul, std::stoul(argv[5]));
+	} catch (std::invalid_argument const &e) {
+		std::cerr << "Invalid command line parameter" << std::endl;
+		return 2;
+	}
+	if (nConnections == 0) {
+		std::cerr << "N_CONNECTIONS must be at least 1" << std::endl;
+		return 2;
+	}
+
+	// every connection sends its share of the requests, with a different seed
+	auto start = high_resolution_clock::now();
+	std::vector<std::thread> connections;
+	for (unsigned int i = 0; i < nConnections; i++) {
+		unsigned int share = nRequests / nConnections + (i < nRequests % nConnections ? 1 : 0);
+		connections.emplace_back(run_connection, address, seed + i, share, window);
+	}
+	for (auto &t: connections)
+		t.join();
+	double seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << "Requests: " << latencies.size() << " (" << failed << " without path)" << std::endl;
+	std::cout << "Time: " << seconds << " seconds" << std::endl;
+	std::cout << "Throughput: " << latencies.size() / seconds << " queries/s" << std::endl;
+	std::cout << "Latency (ms): p50 " << percentile(latencies, 50) << ", p90 " << percentile(latencies, 90)
+	          << ", p99 " << percentile(latencies, 99) << ", max " << (latencies.empty() ? 0 : latencies.back())
+	          << std::endl;
+
+	return latencies.size() == nRequests ? 0 : 4;
+}
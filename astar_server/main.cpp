@@ -0,0 +1,227 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <csignal>
+
+#include "../include/astar/astar_sequential.h"
+#include "../include/graph_utils/graph_utils.h"
+#include "../include/stats/stats.h"
+#include "../include/query_cache/query_cache.h"
+#include "../include/request_server/request_server.h"
+
+// maximum number of requests taken from the queue by a worker at once
+#define SERVER_BATCH_SIZE 32
+// wait of accept after running out of file descriptors or memory, doubled up to the maximum while the error persists
+#define ACCEPT_BACKOFF_MIN_MS 10
+#define ACCEPT_BACKOFF_MAX_MS 1000
+
+#ifndef QUERY_CACHE_SIZE
+#define QUERY_CACHE_SIZE 0
+#endif
+
+#ifdef QUERY_CACHE_SUBPATHS
+#define QUERY_CACHE_SUBPATH_REUSE true
+#else
+#define QUERY_CACHE_SUBPATH_REUSE false
+#endif
+
+using namespace boost;
+
+
+/** types **/
+
+// Socket of a client, closed when the reader and all the pending requests are done with it
+class connection {
+public:
+	int fd;
+	std::mutex writeMutex;
+
+	explicit connection(int fd) : fd(fd) {}
+
+	~connection() {
+		close(fd);
+	}
+};
+
+typedef struct {
+	std::shared_ptr<connection> client;
+	std::string id;
+	NodeId source;
+	NodeId dest;
+} Request;
+
+
+/** globals **/
+
+std::deque<Request> requestQueue;
+std::mutex requestQueueMutex;
+std::condition_variable requestQueueCv;
+
+// socket file removed on exit, nullptr for tcp. Set before installing the signal handler, which can only make async
+// signal safe calls
+const char *socketPath = nullptr;
+
+
+/** functions **/
+
+void handle_signal(int) {
+	if (socketPath != nullptr)
+		unlink(socketPath);
+	_exit(0);
+}
+
+// Parse the requests of a client and push them in the queue, until the client disconnects
+void read_requests(std::shared_ptr<connection> client, unsigned int N, query_cache &cache) {
+	if (!write_all(client->fd, "NODES " + std::to_string(N) + "\n"))
+		return;
+	line_reader reader(client->fd);
+	std::string line;
+	while (reader.next(line)) {
+		if (line == "STATS") {
+			std::ostringstream oss;
+			cache.print_stats(oss);
+			std::unique_lock lock(client->writeMutex);
+			write_all(client->fd, "STATS " + oss.str());
+			continue;
+		}
+		std::istringstream iss(line);
+		Request r{.client = client, .id = {}, .source = 0, .dest = 0};
+		if (!(iss >> r.id >> r.source >> r.dest) || r.source >= N || r.dest >= N) {
+			std::unique_lock lock(client->writeMutex);
+			write_all(client->fd, (r.id.empty() ? "?" : r.id) + " -1 0\n");
+			continue;
+		}
+		{
+			std::unique_lock lock(requestQueueMutex);
+			requestQueue.push_back(r);
+		}
+		requestQueueCv.notify_one();
+	}
+}
+
+// The cost is written with the precision of AstarReport.csv
+std::string format_response(const std::string &id, double cost, const std::vector<NodeId> &path) {
+	std::ostringstream oss;
+	oss << id << " " << cost << " " << path.size() << " ";
+	std::string response = oss.str();
+	for (unsigned int i = 0; i < path.size(); i++) {
+		response += std::to_string(path[i]);
+		response += i < path.size() - 1 ? '-' : '\n';
+	}
+	if (path.empty())
+		response.back() = '\n';
+	return response;
+}
+
+// Take up to SERVER_BATCH_SIZE requests at a time and solve them, then send the responses of the batch with a single
+// write per client. Under load the queue is drained in batches, which amortizes locking and system calls.
+// The search arrays are kept across the requests of the worker
+void worker(const Graph &g, query_cache &cache) {
+	astar_state state;
+	std::vector<Request> batch;
+	std::map<connection *, std::pair<std::shared_ptr<connection>, std::string>> responses;
+	while (true) {
+		{
+			std::unique_lock lock(requestQueueMutex);
+			requestQueueCv.wait(lock, [] { return !requestQueue.empty(); });
+			while (!requestQueue.empty() && batch.size() < SERVER_BATCH_SIZE) {
+				batch.push_back(std::move(requestQueue.front()));
+				requestQueue.pop_front();
+			}
+		}
+
+		for (auto &r: batch) {
+			std::pair<double, std::vector<NodeId>> path_pair;
+			if (!cache.lookup(r.source, r.dest, path_pair.first, path_pair.second)) {
+				stats s("Server", 1, "", 0);
+				path_pair = astar_sequential(g, r.source, r.dest, euclidean_heuristic(), s, state);
+				if (path_pair.first >= 0)
+					cache.insert(g, path_pair.first, path_pair.second);
+				else
+					path_pair.second.clear();
+			}
+			auto &response = responses[r.client.get()];
+			response.first = r.client;
+			response.second += format_response(r.id, path_pair.first, path_pair.second);
+		}
+
+		for (auto &response: responses) {
+			std::unique_lock lock(response.second.first->writeMutex);
+			write_all(response.second.first->fd, response.second.second);
+		}
+		responses.clear();
+		batch.clear();
+	}
+}
+
+int main(int argc, char *argv[]) {
+	// print usage
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " FILENAME ADDRESS [N_WORKERS=hardware threads]" << std::endl;
+		std::cerr << "ADDRESS is the path of a unix domain socket, or a port number to listen on localhost"
+		          << std::endl;
+		return 1;
+	}
+
+	// parse command line parameters
+	char *filename = argv[1];
+	std::string address = argv[2];
+	unsigned int nWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+	try {
+		if (argc >= 4)
+			nWorkers = std::stoul(argv[3]);
+	} catch (std::invalid_argument const &e) {
+		std::cerr << "Invalid command line parameter" << std::endl;
+		return 2;
+	}
+	if (nWorkers == 0) {
+		std::cerr << "N_WORKERS must be at least 1" << std::endl;
+		return 2;
+	}
+
+	// read graph once, it is shared read only by all the workers
+	Graph g = load_graph(filename);
+	unsigned int N = num_vertices(g);
+	query_cache cache(QUERY_CACHE_SIZE, QUERY_CACHE_SUBPATH_REUSE);
+
+	int listenFd = listen_address(address);
+	if (listenFd < 0)
+		return 3;
+	if (!is_tcp_address(address))
+		socketPath = address.c_str();
+	signal(SIGINT, handle_signal);
+	signal(SIGTERM, handle_signal);
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < nWorkers; i++)
+		workers.emplace_back(worker, ref(g), ref(cache));
+	std::cout << "Graph loaded in " << graphLoadInfo.seconds << " seconds, " << N << " nodes. Listening on "
+	          << address << " with " << nWorkers << " workers" << std::endl;
+
+	// out of file descriptors or memory the pending connection stays in the backlog, so accept is retried after a
+	// backoff instead of immediately. The other errors are fatal
+	unsigned int backoffMs = 0;
+	while (true) {
+		int fd = accept(listenFd, nullptr, nullptr);
+		if (fd < 0) {
+			int error = errno; // overwritten by the output below
+			if (error == EINTR || error == ECONNABORTED)
+				continue;
+			std::cerr << "accept: " << strerror(error) << std::endl;
+			if (error != EMFILE && error != ENFILE && error != ENOBUFS && error != ENOMEM) {
+				if (socketPath != nullptr)
+					unlink(socketPath);
+				return 4;
+			}
+			backoffMs = std::min<unsigned int>(std::max<unsigned int>(2 * backoffMs, ACCEPT_BACKOFF_MIN_MS), ACCEPT_BACKOFF_MAX_MS);
+			std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+			continue;
+		}
+		backoffMs = 0;
+		std::thread(read_requests, std::make_shared<connection>(fd), N, ref(cache)).detach();
+	}
+}
@@ -0,0 +1,346 @@
+#include <iostream>
+#include <algorithm>
+#include <cfloat>
+#include <barrier>
+#include <climits>
+
+#include "../include/graph_utils/graph_utils.h"
+#include "../include/stats/stats.h"
+#include "../include/trace/trace.h"
+#include "../include/search_state/search_state.h"
+#include "../include/thread_pool/thread_pool.h"
+
+
+#define N_THREADS 16
+// initial capacity of the path, kept across queries
+#define PATH_RESERVE 1024
+
+// width of the buckets, 0 to use the mean edge weight of the graph
+#ifndef DELTA_STEPPING_DELTA
+#define DELTA_STEPPING_DELTA 0
+#endif
+
+#define NO_BUCKET ULONG_MAX
+
+#define myState ownedStates[threadId]
+#define myRelaxed relaxedStates[threadId]
+#define myBuckets threadBuckets[threadId]
+
+
+using namespace boost;
+
+
+/** types **/
+
+// relaxation of an edge towards a node owned by another thread
+typedef struct {
+	NodeId target;
+	NodeId parent;
+	double cost;
+} Request;
+
+typedef std::vector<NodeId> Bucket;
+
+
+/** globals **/
+
+// cost to come and came from of the nodes owned by each thread, kept across queries
+std::vector<std::unique_ptr<ExactOwnedState>> ownedStates(N_THREADS);
+// cost of the owned nodes when their light edges were last relaxed, to skip duplicate entries of the buckets
+std::vector<std::unique_ptr<ExactOwnedState>> relaxedStates(N_THREADS);
+// buckets of the owned nodes, and the nodes taken from the current bucket, kept across queries with their capacity
+std::vector<std::vector<Bucket>> threadBuckets(N_THREADS);
+std::vector<Bucket> frontiers(N_THREADS);
+std::vector<Bucket> removedNodes(N_THREADS);
+
+// requests[sender][receiver], written by the sender and read by the receiver in different phases
+std::vector<std::vector<std::vector<Request>>> requests(N_THREADS, std::vector<std::vector<Request>>(N_THREADS));
+
+double delta;
+
+// synchronization, each thread writes only its own slot before a barrier
+std::barrier barrier(N_THREADS);
+bool bucketNotEmpty[N_THREADS];
+unsigned long nextBucket[N_THREADS];
+double destCost;
+
+// path reconstruction
+std::vector<NodeId> path;
+
+
+/** functions **/
+
+unsigned long bucket_of(double cost) {
+	return (unsigned long) (cost / delta);
+}
+
+void insert_in_bucket(std::vector<Bucket> &buckets, NodeId n, double cost) {
+	unsigned long b = bucket_of(cost);
+	if (b >= buckets.size())
+		buckets.resize(b + 1);
+	buckets[b].push_back(n);
+}
+
+// Relax the edge parent -> target: owned nodes are updated directly, the others are sent to their owner
+void relax(const unsigned int threadId, std::vector<Bucket> &buckets, NodeId target, double cost, NodeId parent,
+           stats &stat) {
+	unsigned int targetThread = hash_node_id(target, N_THREADS);
+	if (targetThread != threadId) {
+		requests[threadId][targetThread].push_back(Request{.target = target, .parent = parent, .cost = cost});
+		stat.addCounter(threadId, COUNTER_MESSAGES_SENT);
+		return;
+	}
+	if (cost < myState->getCost(target)) {
+		myState->update(target, cost, parent);
+		insert_in_bucket(buckets, target, cost);
+	} else {
+		stat.addCounter(threadId, COUNTER_DUPLICATES);
+	}
+}
+
+// Apply the requests sent to this thread in the last phase
+void process_requests(const unsigned int threadId, std::vector<Bucket> &buckets, stats &stat) {
+	TRACE_SCOPE(threadId, "process requests");
+	for (unsigned int sender = 0; sender < N_THREADS; sender++) {
+		auto &inbox = requests[sender][threadId];
+		stat.addCounter(threadId, COUNTER_MESSAGES_RECEIVED, inbox.size());
+		for (auto &r: inbox)
+			relax(threadId, buckets, r.target, r.cost, r.parent, stat);
+		inbox.clear();
+	}
+}
+
+void wait_barrier([[maybe_unused]] const unsigned int threadId) {
+	TRACE_SCOPE(threadId, "barrier");
+	barrier.arrive_and_wait();
+}
+
+// Delta-stepping (Meyer, Sanders): nodes are kept in buckets of width delta and the buckets are settled in order.
+// Inside a bucket the light edges (weight <= delta) are relaxed in rounds until the bucket stays empty, since they
+// can insert nodes in the same bucket, then the heavy edges of the nodes removed from it are relaxed once.
+// Each thread owns the nodes with hash_node_id(node) == threadId, with their costs and buckets, and sends the
+// relaxations of the other nodes to their owner; the phases are separated by barriers, so no locks are needed
+void delta_stepping(const unsigned int threadId, const Graph &g, const NodeId &pathStart, const NodeId &pathEnd,
+                    stats &stat) {
+	// the state of the owned nodes is allocated by the owner thread for the first query and reset by the next ones,
+	// like in hdastar_shared
+	if (myState == nullptr) {
+		myState = std::make_unique<ExactOwnedState>(num_vertices(g), N_THREADS, threadId);
+		myRelaxed = std::make_unique<ExactOwnedState>(num_vertices(g), N_THREADS, threadId);
+	} else {
+		myState->reset();
+		myRelaxed->reset();
+	}
+	ExactOwnedState &relaxed = *myRelaxed;
+	std::vector<Bucket> &buckets = myBuckets;
+	for (auto &b: buckets)
+		b.clear();
+	Bucket &frontier = frontiers[threadId], &removed = removedNodes[threadId];
+	removed.clear();
+
+	if (hash_node_id(pathStart, N_THREADS) == threadId) {
+		myState->update(pathStart, 0, INVALID_NODE_ID);
+		insert_in_bucket(buckets, pathStart, 0);
+	}
+	barrier.arrive_and_wait();
+	if (threadId == 0)
+		stat.timeStep("Init done");
+
+	stat.startPerfCounters(threadId);
+	unsigned long current = 0;
+	while (true) {
+		// light edges, until no thread has nodes left in the current bucket
+		while (true) {
+			frontier.clear();
+			if (current < buckets.size())
+				std::swap(frontier, buckets[current]);
+			stat.updateHeapPeak(threadId, frontier.size());
+			{
+				TRACE_SCOPE(threadId, "relax light edges");
+				for (NodeId n: frontier) {
+					double cost = myState->getCost(n);
+					if (bucket_of(cost) != current || relaxed.getCost(n) <= cost) {
+						stat.addCounter(threadId, COUNTER_DUPLICATES);
+						continue;
+					}
+					relaxed.update(n, cost, INVALID_NODE_ID);
+					removed.push_back(n);
+					stat.addNodeVisited(threadId);
+					for (auto e: make_iterator_range(out_edges(n, g))) {
+						double weight = get(edge_weight, g, e);
+						if (weight <= delta)
+							relax(threadId, buckets, e.m_target, cost + weight, n, stat);
+					}
+				}
+			}
+			wait_barrier(threadId);
+			process_requests(threadId, buckets, stat);
+			bucketNotEmpty[threadId] = current < buckets.size() && !buckets[current].empty();
+			wait_barrier(threadId);
+
+			bool done = true;
+			for (unsigned int i = 0; i < N_THREADS; i++)
+				done = done && !bucketNotEmpty[i];
+			if (done)
+				break;
+		}
+
+		// heavy edges of the nodes settled in the current bucket. A node whose cost decreased inside the bucket was
+		// removed more times, its heavy edges are relaxed once with the final cost
+		{
+			TRACE_SCOPE(threadId, "relax heavy edges");
+			std::sort(removed.begin(), removed.end());
+			removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+			for (NodeId n: removed) {
+				double cost = myState->getCost(n);
+				for (auto e: make_iterator_range(out_edges(n, g))) {
+					double weight = get(edge_weight, g, e);
+					if (weight > delta)
+						relax(threadId, buckets, e.m_target, cost + weight, n, stat);
+				}
+			}
+			removed.clear();
+		}
+		wait_barrier(threadId);
+		process_requests(threadId, buckets, stat);
+
+		// every cost lower than (current + 1) * delta is now final
+		nextBucket[threadId] = NO_BUCKET;
+		for (unsigned long b = current; b < buckets.size(); b++) {
+			if (!buckets[b].empty()) {
+				nextBucket[threadId] = b;
+				break;
+			}
+		}
+		if (hash_node_id(pathEnd, N_THREADS) == threadId)
+			destCost = myState->getCost(pathEnd);
+		wait_barrier(threadId);
+
+		unsigned long next = NO_BUCKET;
+		for (unsigned int i = 0; i < N_THREADS; i++)
+			next = std::min(next, nextBucket[i]);
+#ifndef DELTA_STEPPING_FULL_SSSP
+		if (destCost < (double) (current + 1) * delta)
+			break;
+#endif
+		if (next == NO_BUCKET)
+			break;
+		current = next;
+	}
+	stat.stopPerfCounters(threadId);
+}
+
+int path_reconstruction([[maybe_unused]] const Graph &g, const NodeId &pathStart, const NodeId &pathEnd,
+                        [[maybe_unused]] stats &stat) {
+	NodeId curr = pathEnd;
+	while (true) {
+		path.emplace_back(curr);
+
+		if (curr == pathStart) {
+			std::reverse(path.begin(), path.end());
+			return 0;
+		}
+
+		NodeId parent = ownedStates[hash_node_id(curr, N_THREADS)]->getParent(curr);
+		if (parent == INVALID_NODE_ID) {
+			std::cerr << "delta_stepping: Error during path reconstruction: Node " << curr << " parent not found"
+			          << std::endl;
+			return 1;
+		}
+		curr = parent;
+	}
+}
+
+// Mean edge weight, a good bucket width for graphs whose edges have similar weights
+double mean_edge_weight(const Graph &g) {
+	double sum = 0;
+	for (auto e: make_iterator_range(edges(g)))
+		sum += get(edge_weight, g, e);
+	return num_edges(g) > 0 ? sum / num_edges(g) : 1;
+}
+
+int main(int argc, char *argv[]) {
+	// print usage
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " FILENAME STARTING_SEED [N_SEEDS=1] [N_REPS=1]" << std::endl;
+		return 1;
+	}
+
+	// parse command line parameters
+	char *filename = argv[1];
+	unsigned long seed;
+	unsigned int nSeeds = 1;
+	unsigned int nReps = 1;
+	try {
+		seed = std::stoul(argv[2]);
+		if (argc >= 4)
+			nSeeds = std::stoul(argv[3]);
+		if (argc >= 5)
+			nReps = std::stoul(argv[4]);
+	} catch (std::invalid_argument const &e) {
+		std::cerr << "Invalid command line parameter" << std::endl;
+		return 2;
+	}
+
+	// read graph
+	Graph g = load_graph(filename);
+	unsigned int N = num_vertices(g);
+	delta = DELTA_STEPPING_DELTA > 0 ? DELTA_STEPPING_DELTA : mean_edge_weight(g);
+	std::cout << "Delta: " << delta << std::endl;
+
+	NodeId source, dest;
+	thread_pool pool(N_THREADS);
+	path.reserve(PATH_RESERVE);
+
+	// monte carlo simulation
+	for (unsigned int k = 0; k < nSeeds; k++) {
+		unsigned int local_seed = seed;
+		for (unsigned int i = 0; i < nReps; i++) {
+			stats s("Delta Stepping", N_THREADS, filename, local_seed);
+
+			// randomize seed every nReps runs
+			if (i % nReps == 0)
+				randomize_source_dest(seed, N, source, dest);
+
+			std::cerr << "Repetition " << k << ", " << i << std::endl;
+			s.timeStep("Start");
+
+			TRACE_INIT(N_THREADS);
+
+			// run threads, owned nodes and buckets are initialized by each thread
+			auto search = [&](unsigned int j) { delta_stepping(j, g, source, dest, s); };
+			pool.run(search);
+			s.timeStep("Astar");
+			TRACE_DUMP("delta_stepping_trace_" + std::to_string(k) + "_" + std::to_string(i) + ".json");
+
+			int path_reconstruction_status = path_reconstruction(ref(g), source, dest, ref(s));
+
+			// path reconstruction
+			if (!path_reconstruction_status) {
+				s.timeStep("Path reconstruction");
+				s.printTimeStats();
+				s.printThreadStats();
+
+				// print paths total cost
+				double cost = 0;
+				for (unsigned int j = 1; j < path.size(); j++) {
+					cost += get(edge_weight, g, edge(path[j - 1], path[j], g).first);
+				}
+				std::cout << "Total cost: " << cost << std::endl;
+				std::cout << "Total steps: " << path.size() << std::endl;
+
+				s.setTotalCost(cost);
+				s.setTotalSteps(path.size());
+				s.dump_csv(path);
+			}
+
+			// cleanup global variables, the owned nodes are reset by their threads
+			path.clear();
+
+			if (path_reconstruction_status)
+				break;
+		}
+	}
+
+	return 0;
+}
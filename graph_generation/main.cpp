@@ -13,8 +13,9 @@ int main(int argc, char *argv[]) {
 	int i, j;
 
 	if (argc < 3) {
-		std::cerr << "usage:" << std::endl << argv[0] << " s n [k]" << std::endl
-		          << "Generates a k-nearest connected graph with n vertices in a grid of size s*s." << std::endl;
+		std::cerr << "usage:" << std::endl << argv[0] << " s n [k] [seed]" << std::endl
+		          << "Generates a k-nearest connected graph with n vertices in a grid of size s*s." << std::endl
+		          << "The same seed generates the same graph, a random one is used if not specified." << std::endl;
 		return 1;
 	}
 
@@ -38,7 +39,7 @@ int main(int argc, char *argv[]) {
 
 	// init random distribution
 	std::random_device dev;
-	std::mt19937 rng(dev());
+	std::mt19937 rng(argc >= 5 ? strtoul(argv[4], nullptr, 10) : dev());
 	std::uniform_int_distribution<std::mt19937::result_type> dist(0, s - 1);
 
 	// generate n random unique points
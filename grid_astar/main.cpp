@@ -0,0 +1,290 @@
+#include <array>
+#include <iostream>
+#include <utility>
+#include <queue>
+#include <cfloat>
+
+#include "../include/astar/astar_sequential.h"
+#include "../include/grid_graph/grid_graph.h"
+#include "../include/stats/stats.h"
+
+// maximum number of random (source, dest) pairs tried to find two free cells
+#define MAX_SOURCE_DEST_ATTEMPTS 1000
+
+using namespace boost;
+
+typedef grid_graph<8> Grid8;
+typedef std::pair<unsigned int, double> NodeFCost;
+
+// Octile distance between two cells of a grid with uniform costs
+double octile_distance(const Grid8 &g, int x1, int y1, int x2, int y2) {
+	double dx = std::abs(x1 - x2);
+	double dy = std::abs(y1 - y2);
+	return g.min_cost() * (dx + dy + (SQRT2 - 2) * std::min(dx, dy));
+}
+
+// Move from (x, y) in direction (dx, dy) until a jump point is found: the target, a cell with a forced neighbor or
+// (moving diagonally) a cell from which a straight jump finds a jump point. Returns INVALID_NODE_ID if a blocked cell
+// is reached first
+NodeId jump(const Grid8 &g, int x, int y, int dx, int dy, NodeId target) {
+	while (true) {
+		if (!g.walkable(x, y))
+			return INVALID_NODE_ID;
+		NodeId n = g.node(x, y);
+		if (n == target)
+			return n;
+		if (dx != 0 && dy != 0) {
+			if (jump(g, x + dx, y, dx, 0, target) != INVALID_NODE_ID ||
+			    jump(g, x, y + dy, 0, dy, target) != INVALID_NODE_ID)
+				return n;
+		} else if (dx != 0) {
+			if ((g.walkable(x, y - 1) && !g.walkable(x - dx, y - 1)) ||
+			    (g.walkable(x, y + 1) && !g.walkable(x - dx, y + 1)))
+				return n;
+		} else {
+			if ((g.walkable(x - 1, y) && !g.walkable(x - 1, y - dy)) ||
+			    (g.walkable(x + 1, y) && !g.walkable(x + 1, y - dy)))
+				return n;
+		}
+		// diagonal moves need both orthogonal cells free
+		if (!g.walkable(x + dx, y) || !g.walkable(x, y + dy))
+			return INVALID_NODE_ID;
+		x += dx;
+		y += dy;
+	}
+}
+
+// Up to the 8 directions of a cell, returned by value so that an expansion does not allocate
+class direction_set {
+	std::array<std::pair<int, int>, 8> dirs;
+	unsigned int n = 0;
+
+public:
+	void add(int dx, int dy) {
+		dirs[n++] = std::make_pair(dx, dy);
+	}
+
+	const std::pair<int, int> *begin() const {
+		return dirs.data();
+	}
+
+	const std::pair<int, int> *end() const {
+		return dirs.data() + n;
+	}
+};
+
+// Directions worth exploring from (x, y) when it was reached moving in direction (dx, dy), (0, 0) for the source
+direction_set pruned_directions(const Grid8 &g, int x, int y, int dx, int dy) {
+	direction_set dirs;
+	if (dx == 0 && dy == 0) {
+		for (int ny = -1; ny <= 1; ny++)
+			for (int nx = -1; nx <= 1; nx++)
+				if ((nx != 0 || ny != 0) && g.walkable(x + nx, y + ny) &&
+				    (nx == 0 || ny == 0 || (g.walkable(x + nx, y) && g.walkable(x, y + ny))))
+					dirs.add(nx, ny);
+	} else if (dx != 0 && dy != 0) {
+		if (g.walkable(x, y + dy))
+			dirs.add(0, dy);
+		if (g.walkable(x + dx, y))
+			dirs.add(dx, 0);
+		if (g.walkable(x, y + dy) && g.walkable(x + dx, y))
+			dirs.add(dx, dy);
+	} else if (dx != 0) {
+		// (x, y +- 1) is forced only if it cannot be reached from the parent without crossing (x, y), i.e. if
+		// (x - dx, y +- 1) is blocked. Then (x + dx, y +- 1) is forced too, otherwise it is reached as well by a
+		// path of the same cost through (x, y +- 1)
+		bool next = g.walkable(x + dx, y);
+		if (next)
+			dirs.add(dx, 0);
+		for (int ny = -1; ny <= 1; ny += 2) {
+			if (g.walkable(x, y + ny) && !g.walkable(x - dx, y + ny)) {
+				dirs.add(0, ny);
+				if (next)
+					dirs.add(dx, ny);
+			}
+		}
+	} else {
+		bool next = g.walkable(x, y + dy);
+		if (next)
+			dirs.add(0, dy);
+		for (int nx = -1; nx <= 1; nx += 2) {
+			if (g.walkable(x + nx, y) && !g.walkable(x + nx, y - dy)) {
+				dirs.add(nx, 0);
+				if (next)
+					dirs.add(nx, dy);
+			}
+		}
+	}
+	return dirs;
+}
+
+// Jump Point Search (Harabor, Grastien), variant without corner cutting. Only valid on 8-connected grids with uniform
+// costs, where it finds a path of the same cost as A* expanding only the jump points
+std::pair<double, std::vector<NodeId>> jps(const Grid8 &g, NodeId source, NodeId target, stats &s) {
+	auto comp = [](NodeFCost a, NodeFCost b) { return a.second > b.second; };
+	std::priority_queue<NodeFCost, std::vector<NodeFCost>, decltype(comp)> openSet;
+	unsigned long long V = num_vertices(g);
+	std::vector<bool> closedSet(V, false);
+	std::vector<double> costToCome(V, DBL_MAX);
+	std::vector<NodeId> cameFrom(V, INVALID_NODE_ID);
+	int tx = g.x(target), ty = g.y(target);
+
+	costToCome[source] = 0;
+	openSet.push(NodeFCost(source, 0));
+	s.startPerfCounters(0);
+
+	while (!openSet.empty()) {
+		s.updateHeapPeak(0, openSet.size());
+		NodeId curr = openSet.top().first;
+		openSet.pop();
+		if (curr == target)
+			break;
+		if (closedSet[curr]) {
+			s.addCounter(0, COUNTER_DUPLICATES);
+			continue;
+		}
+		closedSet[curr] = true;
+		s.addNodeVisited(0);
+
+		int x = g.x(curr), y = g.y(curr), dx = 0, dy = 0;
+		if (cameFrom[curr] != INVALID_NODE_ID) {
+			dx = (x > g.x(cameFrom[curr])) - (x < g.x(cameFrom[curr]));
+			dy = (y > g.y(cameFrom[curr])) - (y < g.y(cameFrom[curr]));
+		}
+		for (auto &d: pruned_directions(g, x, y, dx, dy)) {
+			NodeId jp = jump(g, x + d.first, y + d.second, d.first, d.second, target);
+			if (jp == INVALID_NODE_ID || closedSet[jp])
+				continue;
+			int jx = g.x(jp), jy = g.y(jp);
+			double gCost = costToCome[curr] + octile_distance(g, x, y, jx, jy);
+			if (gCost >= costToCome[jp]) {
+				s.addCounter(0, COUNTER_DUPLICATES);
+				continue;
+			}
+			cameFrom[jp] = curr;
+			costToCome[jp] = gCost;
+			openSet.push(NodeFCost(jp, gCost + octile_distance(g, jx, jy, tx, ty)));
+		}
+	}
+	s.stopPerfCounters(0);
+	s.timeStep("Astar");
+
+	std::vector<NodeId> path;
+	if (costToCome[target] == DBL_MAX)
+		return std::make_pair(-1, path);
+	// jump points are connected by straight or diagonal segments, add the cells in between
+	path.emplace_back(target);
+	NodeId curr = target;
+	while (curr != source) {
+		NodeId parent = cameFrom[curr];
+		int x = g.x(curr), y = g.y(curr), px = g.x(parent), py = g.y(parent);
+		int dx = (px > x) - (px < x), dy = (py > y) - (py < y);
+		while (x != px || y != py) {
+			x += dx;
+			y += dy;
+			path.emplace_back(g.node(x, y));
+		}
+		curr = parent;
+	}
+	std::reverse(path.begin(), path.end());
+	s.timeStep("Path reconstruction");
+	return std::make_pair(costToCome[target], path);
+}
+
+void dump_run(stats &s, const std::pair<double, std::vector<NodeId>> &path_pair) {
+	s.printTimeStats();
+
+	std::cout << "Total cost: " << path_pair.first << std::endl;
+	std::cout << "Total steps: " << path_pair.second.size() << std::endl;
+
+	s.setTotalCost(path_pair.first);
+	s.setTotalSteps(path_pair.second.size());
+	s.dump_csv(path_pair.second);
+}
+
+template<unsigned int Connectivity>
+void run(char *filename, unsigned long seed, unsigned int nSeeds, unsigned int nReps) {
+	// read map
+	grid_graph<Connectivity> g = read_grid_map<Connectivity>(filename);
+	unsigned int N = num_vertices(g);
+	bool useJps = Connectivity == 8 && g.uniform();
+	if (!useJps)
+		std::cerr << "Jump point search needs an 8-connected map with uniform costs, running only A*" << std::endl;
+
+	NodeId source, dest;
+
+	// monte carlo simulation
+	for (unsigned int k = 0; k < nSeeds; k++) {
+		unsigned int local_seed = seed;
+		// source and dest must be free cells
+		int attempts = 0;
+		do {
+			randomize_source_dest(seed, N, source, dest);
+		} while ((!g.walkable(source) || !g.walkable(dest)) && ++attempts < MAX_SOURCE_DEST_ATTEMPTS);
+		if (attempts == MAX_SOURCE_DEST_ATTEMPTS) {
+			std::cerr << "Cannot find two free cells" << std::endl;
+			return;
+		}
+
+		for (unsigned int i = 0; i < nReps; i++) {
+			std::cerr << "Repetition " << k << ", " << i << std::endl;
+
+			stats s("Grid A*", 1, filename, local_seed);
+			s.timeStep("Start");
+			auto path_pair = astar_sequential(g, source, dest, octile_heuristic(), s);
+			if (path_pair.first < 0) {
+				std::cerr << "No path between " << source << " and " << dest << std::endl;
+				break;
+			}
+			dump_run(s, path_pair);
+
+			if constexpr (Connectivity == 8) {
+				if (useJps) {
+					stats sj("Grid JPS", 1, filename, local_seed);
+					sj.timeStep("Start");
+					dump_run(sj, jps(g, source, dest, sj));
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	// print usage
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " MAP_FILENAME STARTING_SEED [N_SEEDS=1] [N_REPS=1] [CONNECTIVITY=8]"
+		          << std::endl;
+		return 1;
+	}
+
+	// parse command line parameters
+	char *filename = argv[1];
+	unsigned long seed;
+	unsigned int nSeeds = 1;
+	unsigned int nReps = 1;
+	unsigned int connectivity = 8;
+	try {
+		seed = std::stoul(argv[2]);
+		if (argc >= 4)
+			nSeeds = std::stoul(argv[3]);
+		if (argc >= 5)
+			nReps = std::stoul(argv[4]);
+		if (argc >= 6)
+			connectivity = std::stoul(argv[5]);
+	} catch (std::invalid_argument const &e) {
+		std::cerr << "Invalid command line parameter" << std::endl;
+		return 2;
+	}
+
+	// the engine is compiled separately for each connectivity
+	if (connectivity == 8)
+		run<8>(filename, seed, nSeeds, nReps);
+	else if (connectivity == 4)
+		run<4>(filename, seed, nSeeds, nReps);
+	else {
+		std::cerr << "CONNECTIVITY must be 4 or 8" << std::endl;
+		return 2;
+	}
+
+	return 0;
+}
@@ -8,9 +8,16 @@
 
 #include "../include/graph_utils/graph_utils.h"
 #include "../include/stats/stats.h"
+#include "../include/search_state/search_state.h"
+#include "../include/trace/trace.h"
+#include "../include/arena/arena.h"
+#include "../include/thread_pool/thread_pool.h"
 
 #define N_THREADS 16
 #define FREELIST_SIZE 32
+#define OPEN_SET_RESERVE 4096
+// initial capacity of the path, kept across queries
+#define PATH_RESERVE 1024
 
 using namespace boost;
 
@@ -26,21 +33,26 @@ typedef enum {
 	PATH_END
 } MessageType;
 
+// the fields not used by a message type keep their defaults
 typedef struct {
 	MessageType type;
-	NodeId target;
-	NodeId parent;
-	double fCost;
-	double gCost;
+	NodeId target = INVALID_NODE_ID;
+	NodeId parent = INVALID_NODE_ID;
+	double fCost = 0;
+	double gCost = 0;
 } Message;
 
 
 /** globals **/
 
 const auto queue_comparator = [](const NodeFCost &a, const NodeFCost &b) { return a.second > b.second; };
+typedef arena_priority_queue<NodeFCost, decltype(queue_comparator)> OpenSet;
 
-std::vector<std::thread> threads(N_THREADS);
+// message queues, open sets and owned nodes are kept across queries: the queues keep in their freelist the nodes
+// allocated by the largest search, the open sets their storage
 std::vector<std::unique_ptr<lockfree::queue<Message>>> messageQueues(N_THREADS);
+std::vector<std::unique_ptr<OpenSet>> openSets(N_THREADS);
+std::vector<std::unique_ptr<OwnedState>> ownedStates(N_THREADS);
 std::barrier barrier(N_THREADS);
 bool finished[N_THREADS];
 bool pathReconstructed = false;
@@ -50,14 +62,14 @@ std::vector<std::unique_ptr<std::counting_semaphore<N_THREADS>>> semaphores(N_TH
 /** functions **/
 
 void broadcast_message(const Message &m, const unsigned int senderId) {
-	for (int i = 0; i < N_THREADS; i++) {
+	for (unsigned int i = 0; i < N_THREADS; i++) {
 		if (i == senderId) continue;
 		messageQueues[i]->push(m);
 	}
 }
 
-bool has_finished(double &bestPathWeight) {
-	for (int i = 0; i < N_THREADS; i++) {
+bool has_finished() {
+	for (unsigned int i = 0; i < N_THREADS; i++) {
 		if (!finished[i]) {
 			return false;
 		}
@@ -65,20 +77,26 @@ bool has_finished(double &bestPathWeight) {
 	return true;
 }
 
-// empty message queue
-void process_queue(const unsigned int threadId, Message &m,
-                   std::priority_queue<NodeFCost, std::vector<NodeFCost>, decltype(queue_comparator)> &openSet,
-                   double *costToCome, NodeId *cameFrom, double &bestPathWeight) {
-	while (messageQueues[threadId]->pop(m)) {
+// empty message queue, traced as "process queue" only if there are messages
+void process_queue(const unsigned int threadId, Message &m, OpenSet &openSet, OwnedState &state,
+                   double &bestPathWeight, stats &stat) {
+	if (!messageQueues[threadId]->pop(m))
+		return;
+	TRACE_SPAN(threadId, "process queue");
+	do {
+		stat.addCounter(threadId, COUNTER_MESSAGES_RECEIVED);
 		switch (m.type) {
 			// move work messages to open set if no duplicates
 			case WORK:
 				if (m.fCost < bestPathWeight) {
-					if (costToCome[m.target] > m.gCost) {
+					if (state.getCost(m.target) > m.gCost) {
 						openSet.push(NodeFCost(m.target, m.fCost));
-						costToCome[m.target] = m.gCost;
-						cameFrom[m.target] = m.parent;
+						state.update(m.target, m.gCost, m.parent);
+					} else {
+						stat.addCounter(threadId, COUNTER_DUPLICATES);
 					}
+				} else {
+					stat.addCounter(threadId, COUNTER_PRUNED);
 				}
 				break;
 
@@ -89,34 +107,48 @@ void process_queue(const unsigned int threadId, Message &m,
 			default:
 				std::cerr << "WORK thread " << threadId << " : Invalid message type: " << m.type << std::endl;
 		}
-	}
+	} while (messageQueues[threadId]->pop(m));
 }
 
-void hdastar_message_passing(const unsigned int threadId, const Graph &g, const NodeId &pathStart, const NodeId &pathEnd,
-							 stats &stat) {
-	std::priority_queue<NodeFCost, std::vector<NodeFCost>, decltype(queue_comparator)> openSet(queue_comparator);
-	unsigned int N = num_vertices(g);
-	double *costToCome = new double[N];
-	std::fill_n(costToCome, N, DBL_MAX);
-	NodeId *cameFrom = new NodeId[N];
-	std::fill_n(cameFrom, N, INVALID_NODE_ID);
+// Search of thread threadId, templated over the graph and the heuristic like astar_sequential: G must provide
+// num_vertices(g) and for_each_neighbor(g, node, f), H is called as h(g, node, target) and must be admissible
+template<typename G, typename H>
+void hdastar_message_passing(const unsigned int threadId, const G &g, const NodeId &pathStart, const NodeId &pathEnd,
+                             const H &h, stats &stat) {
+	// only the nodes owned by this thread are ever read or written by it, and they are allocated by this thread so
+	// that with NUMA_AWARE they are placed on its NUMA node. They are allocated by the first query and reused
+	if (openSets[threadId] == nullptr) {
+		openSets[threadId] = std::make_unique<OpenSet>(queue_comparator, OPEN_SET_RESERVE);
+		ownedStates[threadId] = std::make_unique<OwnedState>(num_vertices(g), N_THREADS, threadId);
+	} else {
+		openSets[threadId]->reset();
+		ownedStates[threadId]->reset();
+	}
+	OpenSet &openSet = *openSets[threadId];
+	OwnedState &state = *ownedStates[threadId];
 	double bestPathWeight = DBL_MAX;
 	Message m;
+	stat.startPerfCounters(threadId);
 
 	while (true) {
 		// empty message queue
-		process_queue(threadId, m, openSet, costToCome, cameFrom, bestPathWeight);
+		process_queue(threadId, m, openSet, state, bestPathWeight, stat);
 
 		// termination condition
 		if (openSet.empty()) {
-			barrier.arrive_and_wait();
+			{
+				TRACE_SCOPE(threadId, "barrier");
+				barrier.arrive_and_wait();
+			}
 			// set finished flag
-			process_queue(threadId, m, openSet, costToCome, cameFrom, bestPathWeight);
+			process_queue(threadId, m, openSet, state, bestPathWeight, stat);
 			finished[threadId] = openSet.empty();
+			TRACE_SCOPE(threadId, "barrier");
 			barrier.arrive_and_wait();
 
 			// check if all threads finished working, otherwise continue
-			if (has_finished(bestPathWeight)) {
+			if (has_finished()) {
+				stat.stopPerfCounters(threadId);
 				break;
 			} else {
 				continue;
@@ -124,10 +156,13 @@ void hdastar_message_passing(const unsigned int threadId, const Graph &g, const
 		}
 
 		// pop first from open set
+		stat.updateHeapPeak(threadId, openSet.size());
 		NodeFCost n = openSet.top();
 		openSet.pop();
-		if (n.second >= bestPathWeight)
+		if (n.second >= bestPathWeight) {
+			stat.addCounter(threadId, COUNTER_PRUNED);
 			continue;
+		}
 
 		// check if we reached end of path
 		if (n.first == pathEnd) {
@@ -136,42 +171,45 @@ void hdastar_message_passing(const unsigned int threadId, const Graph &g, const
 				bestPathWeight = n.second;
 				Message targetReached{.type = TARGET_REACHED, .target = n.first, .fCost = n.second};
 				broadcast_message(targetReached, threadId);
+				stat.addCounter(threadId, COUNTER_MESSAGES_SENT, N_THREADS - 1);
 			}
 			continue;
 		}
 
 		// iterate over neighbors
-		double ctc = costToCome[n.first];
+		TRACE_SPAN(threadId, "expand");
+		double ctc = state.getCost(n.first);
 		stat.addNodeVisited(threadId);
-		for (auto neighbor: make_iterator_range(out_edges(n.first, g))) {
-			double weight = get(edge_weight, g, neighbor);
+		for_each_neighbor(g, n.first, [&](NodeId target, double weight) {
 			double gCost = ctc + weight;
-			double fCost = gCost + calc_h_cost(g, neighbor.m_target, pathEnd);
+			double fCost = gCost + h(g, target, pathEnd);
 
 			if (fCost < bestPathWeight) {
-				unsigned int targetThread = hash_node_id(neighbor.m_target, N_THREADS);
+				unsigned int targetThread = hash_node_id(target, N_THREADS);
 				if (targetThread == threadId) {
 					// send to this open set
-					if (costToCome[neighbor.m_target] > gCost) {
-						openSet.push(NodeFCost(neighbor.m_target, fCost));
-						costToCome[neighbor.m_target] = gCost;
-						cameFrom[neighbor.m_target] = n.first;
+					if (state.getCost(target) > gCost) {
+						openSet.push(NodeFCost(target, fCost));
+						state.update(target, gCost, n.first);
+					} else {
+						stat.addCounter(threadId, COUNTER_DUPLICATES);
 					}
 				} else {
 					// create message
-					Message outgoing{.type = WORK, .target = (NodeId) neighbor.m_target, .parent = n.first, .fCost = fCost, .gCost = gCost};
+					Message outgoing{.type = WORK, .target = target, .parent = n.first, .fCost = fCost, .gCost = gCost};
 					// send message
 					messageQueues[targetThread]->push(outgoing);
+					stat.addCounter(threadId, COUNTER_MESSAGES_SENT);
 				}
+			} else {
+				stat.addCounter(threadId, COUNTER_PRUNED);
 			}
-		}
+		});
 	}
 
 	if (threadId == 0)
 		stat.timeStep("Astar");
 
-	delete[] costToCome;
-
 	// Path Reconstruction
 	if (hash_node_id(pathEnd, N_THREADS) == threadId) {
 		messageQueues[threadId]->push(Message{.type = PATH_RECONSTRUCTION, .target = pathEnd});
@@ -182,7 +220,10 @@ void hdastar_message_passing(const unsigned int threadId, const Graph &g, const
 	unsigned int prevThread;
 
 	while (true) {
-		semaphores[threadId]->acquire();
+		{
+			TRACE_SCOPE(threadId, "path reconstruction wait");
+			semaphores[threadId]->acquire();
+		}
 		if (!messageQueues[threadId]->pop(m)) {
 			continue;
 		}
@@ -193,22 +234,20 @@ void hdastar_message_passing(const unsigned int threadId, const Graph &g, const
 				if (m.target == pathStart) {
 					broadcast_message(Message{.type = PATH_END}, threadId);
 					pathReconstructed = true;
-					for (int i = 0; i < N_THREADS; i++)
+					for (unsigned int i = 0; i < N_THREADS; i++)
 						if (i != threadId)
 							semaphores[i]->release();
-					delete[] cameFrom;
 					return;
 				} else {
-					prev = cameFrom[m.target];
+					prev = state.getParent(m.target);
 					if (prev == INVALID_NODE_ID) {
 						std::cerr << "hdastar_message_passing: Error reconstructing path: " << m.target
 						          << " Nodes parent not found" << std::endl;
 						pathReconstructed = false;
 						broadcast_message(Message{.type = PATH_END}, threadId);
-						for (int i = 0; i < N_THREADS; i++)
+						for (unsigned int i = 0; i < N_THREADS; i++)
 							if (i != threadId)
 								semaphores[i]->release();
-						delete[] cameFrom;
 						return;
 					}
 					prevThread = hash_node_id(prev, N_THREADS);
@@ -217,7 +256,6 @@ void hdastar_message_passing(const unsigned int threadId, const Graph &g, const
 				}
 				break;
 			case PATH_END:
-				delete[] cameFrom;
 				return;
 			default:
 				std::cerr << "PATH RECONSTRUCTION " << threadId << " : Invalid message type: " << m.type << std::endl;
@@ -249,15 +287,17 @@ int main(int argc, char *argv[]) {
 	}
 
 	// read graph
-	Graph g = read_graph(filename);
+	Graph g = load_graph(filename);
 	unsigned int N = num_vertices(g);
 
 	NodeId source, dest;
+	thread_pool pool(N_THREADS);
+	path.reserve(PATH_RESERVE);
 
 	// monte carlo simulation
-	for (int k = 0; k < nSeeds; k++) {
+	for (unsigned int k = 0; k < nSeeds; k++) {
 		unsigned int local_seed = seed;
-		for (int i = 0; i < nReps; i++) {
+		for (unsigned int i = 0; i < nReps; i++) {
 			stats s("HDA* Message Passing", N_THREADS, filename, local_seed);
 
 			// randomize seed every nReps runs
@@ -267,33 +307,35 @@ int main(int argc, char *argv[]) {
 			std::cerr << "Repetition " << k << ", " << i << std::endl;
 			s.timeStep("Start");
 
-			// init global variables
-			for (int j = 0; j < N_THREADS; j++) {
-				messageQueues[j] = std::make_unique<lockfree::queue<Message>>(FREELIST_SIZE);
-				semaphores[j] = std::make_unique<std::counting_semaphore<N_THREADS>>(0);
+			// init global variables, the queues and semaphores of the previous query are emptied and reused
+			for (unsigned int j = 0; j < N_THREADS; j++) {
+				if (messageQueues[j] == nullptr) {
+					messageQueues[j] = std::make_unique<lockfree::queue<Message>>(FREELIST_SIZE);
+					semaphores[j] = std::make_unique<std::counting_semaphore<N_THREADS>>(0);
+				}
+				messageQueues[j]->consume_all([](const Message &) {});
+				while (semaphores[j]->try_acquire());
 			}
 
 			Message m{.type = WORK, .target = (NodeId) source, .parent = (NodeId) source, .fCost = 0, .gCost = 0};
 			messageQueues[hash_node_id(source, N_THREADS)]->push(m);
 			s.timeStep("Queues init");
+			TRACE_INIT(N_THREADS);
 
 			// run threads
-			for (int j = 0; j < N_THREADS; j++) {
-				threads[j] = std::thread(hdastar_message_passing, j, ref(g), source, dest, ref(s));
-			}
-
-			for (int j = 0; j < N_THREADS; j++) {
-				threads[j].join();
-			}
+			auto search = [&](unsigned int j) { hdastar_message_passing(j, g, source, dest, euclidean_heuristic(), s); };
+			pool.run(search);
+			TRACE_DUMP("hdastar_message_passing_trace_" + std::to_string(k) + "_" + std::to_string(i) + ".json");
 
 			// print stats on success
 			if (pathReconstructed) {
 				s.timeStep("Path reconstruction");
 				s.printTimeStats();
+				s.printThreadStats();
 
 				// Print paths total cost
 				double cost = 0;
-				for (int j = 1; j < path.size(); j++) {
+				for (unsigned int j = 1; j < path.size(); j++) {
 					cost += get(edge_weight, g, edge(path[j - 1], path[j], g).first);
 				}
 				std::cout << "Total cost: " << cost << std::endl;
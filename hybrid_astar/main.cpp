@@ -0,0 +1,168 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cfloat>
+
+#include "../include/astar/astar_sequential.h"
+#include "../include/graph_utils/graph_utils.h"
+#include "../include/stats/stats.h"
+#include "../include/trace/trace.h"
+#include "../include/hdastar_shared/hdastar_shared.h"
+
+// nodes expanded by the sequential search before escalating to HDA*
+#define HYBRID_NODE_BUDGET 10000
+// nodes expanded by the sequential search before checking if it is expected to end within the node budget
+#define HYBRID_PROBE_BUDGET 1000
+
+using namespace boost;
+using namespace std::chrono;
+
+typedef enum {
+	SEQUENTIAL, // solved within the node budget
+	ESCALATED, // budget exceeded, continued by HDA* from the sequential frontier
+	PROBED, // not expected to end within the budget after the probe, continued by HDA* from the sequential frontier
+	PARALLEL // source and dest too far, HDA* from the start
+} Decision;
+
+const char *const decisionNames[] = {"sequential", "escalated", "probed", "parallel"};
+
+// Append the decision taken for a query and its outcome to HybridReport.csv, to tune the thresholds of a map
+void log_decision(const std::string &filename, unsigned long seed, NodeId source, NodeId dest, double distance,
+                  Decision decision, unsigned long long nodeBudget, unsigned long long sequentialExpanded,
+                  unsigned long long frontierSize, unsigned long long parallelExpanded, double sequentialTime,
+                  double parallelTime, double cost, unsigned long long steps) {
+	std::fstream outFile("HybridReport.csv", std::fstream::out | std::fstream::app);
+	outFile << filename << "," << seed << "," << source << "," << dest << "," << distance << ","
+	        << decisionNames[decision] << "," << nodeBudget << "," << sequentialExpanded << "," << frontierSize << ","
+	        << parallelExpanded << "," << sequentialTime << "," << parallelTime << "," << cost << "," << steps
+	        << std::endl;
+	outFile.close();
+}
+
+// Run HDA* with shared memory from the source, or from the frontier of a previous search if not null
+std::pair<double, std::vector<NodeId>> run_hdastar_shared(thread_pool &pool, const Graph &g, NodeId source, NodeId dest,
+                                                          const std::vector<FrontierNode> *frontier, stats &s) {
+	initialFrontier = frontier;
+	auto search = [&](unsigned int j) { hdastar_shared(j, g, source, dest, euclidean_heuristic(), s); };
+	pool.run(search);
+	s.timeStep("Astar");
+
+	std::pair<double, std::vector<NodeId>> path_pair(-1, std::vector<NodeId>());
+	if (!path_reconstruction(g, source, dest, s)) {
+		s.timeStep("Path reconstruction");
+		path_pair.first = 0;
+		for (unsigned int j = 1; j < path.size(); j++) {
+			path_pair.first += get(edge_weight, g, edge(path[j - 1], path[j], g).first);
+		}
+		path_pair.second = path;
+	}
+	hdastar_shared_cleanup();
+	return path_pair;
+}
+
+int main(int argc, char *argv[]) {
+	// print usage
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " FILENAME STARTING_SEED [N_SEEDS=1] [N_REPS=1] [NODE_BUDGET="
+		          << HYBRID_NODE_BUDGET << "] [DISTANCE_THRESHOLD=inf] [PROBE_BUDGET=" << HYBRID_PROBE_BUDGET << "]"
+		          << std::endl;
+		return 1;
+	}
+
+	// parse command line parameters
+	char *filename = argv[1];
+	unsigned long seed;
+	unsigned int nSeeds = 1;
+	unsigned int nReps = 1;
+	unsigned long long nodeBudget = HYBRID_NODE_BUDGET;
+	double distanceThreshold = DBL_MAX;
+	unsigned long long probeBudget = HYBRID_PROBE_BUDGET;
+	try {
+		seed = std::stoul(argv[2]);
+		if (argc >= 4)
+			nSeeds = std::stoul(argv[3]);
+		if (argc >= 5)
+			nReps = std::stoul(argv[4]);
+		if (argc >= 6)
+			nodeBudget = std::stoull(argv[5]);
+		if (argc >= 7)
+			distanceThreshold = std::stod(argv[6]);
+		if (argc >= 8)
+			probeBudget = std::stoull(argv[7]);
+	} catch (std::invalid_argument const &e) {
+		std::cerr << "Invalid command line parameter" << std::endl;
+		return 2;
+	}
+
+	// read graph
+	Graph g = load_graph(filename);
+	unsigned int N = num_vertices(g);
+
+	// set by the first repetition of every seed
+	NodeId source = 0, dest = 0;
+	thread_pool pool(N_THREADS);
+	path.reserve(PATH_RESERVE);
+
+	// monte carlo simulation
+	for (unsigned int k = 0; k < nSeeds; k++) {
+		unsigned int local_seed = seed;
+		for (unsigned int i = 0; i < nReps; i++) {
+			stats s("Hybrid", N_THREADS, filename, local_seed);
+
+			// randomize seed every nReps runs
+			if (i % nReps == 0)
+				randomize_source_dest(seed, N, source, dest);
+
+			std::cerr << "Repetition " << k << ", " << i << std::endl;
+			s.timeStep("Start");
+
+			// the euclidean distance is a lower bound of the cost: far queries go straight to HDA*, the others start
+			// sequentially and escalate if they expand more than nodeBudget nodes, or earlier if the probe of the first
+			// probeBudget expansions shows that they are not going to end within nodeBudget (0 disables the probe)
+			double distance = calc_h_cost(g, source, dest);
+			Decision decision = distance >= distanceThreshold ? PARALLEL : SEQUENTIAL;
+			std::pair<double, std::vector<NodeId>> path_pair;
+			std::vector<FrontierNode> frontier;
+			unsigned long long sequentialExpanded = 0, frontierSize = 0;
+			double sequentialTime = 0, parallelTime = 0;
+
+			if (decision == SEQUENTIAL) {
+				auto start = high_resolution_clock::now();
+				path_pair = astar_sequential(g, source, dest, euclidean_heuristic(), s, nodeBudget, &frontier,
+				                             probeBudget > 0 ? probeBudget : ULLONG_MAX);
+				sequentialTime = duration<double>(high_resolution_clock::now() - start).count();
+				sequentialExpanded = s.getCounter(COUNTER_EXPANDED);
+				if (path_pair.first == SEARCH_BUDGET_EXCEEDED) {
+					decision = sequentialExpanded < nodeBudget ? PROBED : ESCALATED;
+					for (auto &f: frontier)
+						frontierSize += f.open;
+				}
+			}
+			if (decision != SEQUENTIAL) {
+				TRACE_INIT(N_THREADS);
+				auto start = high_resolution_clock::now();
+				path_pair = run_hdastar_shared(pool, g, source, dest, decision != PARALLEL ? &frontier : nullptr, s);
+				parallelTime = duration<double>(high_resolution_clock::now() - start).count();
+				TRACE_DUMP("hybrid_astar_trace_" + std::to_string(k) + "_" + std::to_string(i) + ".json");
+			}
+
+			log_decision(filename, local_seed, source, dest, distance, decision, nodeBudget, sequentialExpanded,
+			             frontierSize, s.getCounter(COUNTER_EXPANDED) - sequentialExpanded, sequentialTime,
+			             parallelTime, path_pair.first, path_pair.second.size());
+
+			if (path_pair.first < 0)
+				break;
+
+			s.printTimeStats();
+			std::cout << "Decision: " << decisionNames[decision] << std::endl;
+			std::cout << "Total cost: " << path_pair.first << std::endl;
+			std::cout << "Total steps: " << path_pair.second.size() << std::endl;
+
+			s.setTotalCost(path_pair.first);
+			s.setTotalSteps(path_pair.second.size());
+			s.dump_csv(path_pair.second);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <iostream>
+#include <vector>
+
+#if defined(NUMA_AWARE) && defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(NUMA_AWARE) && defined(__linux__)
+// Cpus the process is allowed to run on, read once by the first pinned thread
+const std::vector<int> &allowed_cpus() {
+	static const std::vector<int> cpus = [] {
+		std::vector<int> allowedCpus;
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+				if (CPU_ISSET(cpu, &allowed))
+					allowedCpus.push_back(cpu);
+		}
+		return allowedCpus;
+	}();
+	return cpus;
+}
+#endif
+
+// Pin the calling thread to a single cpu, chosen round robin among the cpus the process is allowed to run on.
+// Memory first touched by a pinned thread is allocated by linux on the NUMA node of its cpu, so data allocated and
+// initialized by the owner thread stays local for its whole life. The threads of thread_pool are pinned once when
+// they start.
+// Does nothing unless NUMA_AWARE is defined (linux only)
+void pin_thread([[maybe_unused]] unsigned int threadId) {
+#if defined(NUMA_AWARE) && defined(__linux__)
+	const std::vector<int> &cpus = allowed_cpus();
+	if (cpus.empty())
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpus[threadId % cpus.size()], &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		std::cerr << "pin_thread: Cannot pin thread " << threadId << " to cpu " << cpus[threadId % cpus.size()]
+		          << std::endl;
+#endif
+}
+
+#endif
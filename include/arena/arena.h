@@ -0,0 +1,58 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <queue>
+#include <vector>
+
+/** allocation tracking **/
+
+// With COUNT_ALLOCATIONS every allocation made with operator new (containers, queues, threads) is counted by the
+// replacement operators of count_allocations.cpp, so that stats can report the allocations done by each query and
+// check that the engines reusing their arenas don't allocate in steady state. Without it the counts are always 0
+#ifdef COUNT_ALLOCATIONS
+extern std::atomic<unsigned long long> allocationCount;
+extern std::atomic<unsigned long long> allocatedBytes;
+#endif
+
+inline unsigned long long allocation_count() {
+#ifdef COUNT_ALLOCATIONS
+	return allocationCount.load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+inline unsigned long long allocated_bytes() {
+#ifdef COUNT_ALLOCATIONS
+	return allocatedBytes.load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+
+/** arenas **/
+
+// Priority queue whose storage is kept across queries. The vector behind it keeps the capacity reached by the largest
+// search (the high-water mark), so after the first queries pushes never reallocate.
+// The owner thread should create it, so that with NUMA_AWARE the storage stays on its NUMA node
+template<typename T, typename Compare>
+class arena_priority_queue : public std::priority_queue<T, std::vector<T>, Compare> {
+public:
+	arena_priority_queue(const Compare &compare, size_t initialCapacity)
+			: std::priority_queue<T, std::vector<T>, Compare>(compare) {
+		this->c.reserve(initialCapacity);
+	}
+
+	// Empty the queue before a new query, keeping its storage
+	void reset() {
+		this->c.clear();
+	}
+
+	size_t capacity() const {
+		return this->c.capacity();
+	}
+};
+
+#endif
@@ -0,0 +1,114 @@
+// Replacement operator new and delete counting every allocation, compiled and linked once into every executable only
+// with COUNT_ALLOCATIONS (see arena.h). All the overloads are replaced, including the aligned and nothrow ones, so
+// that no allocation of the standard library goes around the counters
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+std::atomic<unsigned long long> allocationCount = 0;
+std::atomic<unsigned long long> allocatedBytes = 0;
+
+namespace {
+
+void *counted_alloc(std::size_t size, std::size_t alignment) noexcept {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	if (size == 0)
+		size = 1;
+	if (alignment <= alignof(std::max_align_t))
+		return std::malloc(size);
+	// aligned_alloc needs a size multiple of the alignment
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void *counted_alloc_or_throw(std::size_t size, std::size_t alignment) {
+	void *p = counted_alloc(size, alignment);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+}
+
+void *operator new(std::size_t size) {
+	return counted_alloc_or_throw(size, 0);
+}
+
+void *operator new[](std::size_t size) {
+	return counted_alloc_or_throw(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+	return counted_alloc_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+	return counted_alloc_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+	return counted_alloc(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+	return counted_alloc(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+	return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+// malloc and aligned_alloc memory are both released by free
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+	std::free(p);
+}
@@ -0,0 +1,213 @@
+#ifndef ASTAR_SEQUENTIAL_H
+#define ASTAR_SEQUENTIAL_H
+
+#include <iostream>
+#include <utility>
+#include <queue>
+#include <cfloat> // Needed to use DBL_MAX
+#include <climits>
+#include <type_traits>
+
+#include "../graph_utils/graph_utils.h"
+#include "../stats/stats.h"
+#include "../search_state/search_state.h"
+#include "../soa_graph/soa_graph.h"
+
+// Sequential A*, templated over the graph and the heuristic so that the neighbor generation and the heuristic of
+// implicit graphs are inlined in the search loop.
+// G must provide num_vertices(g) and for_each_neighbor(g, node, f), calling f(neighbor, weight) for every edge;
+// H is called as h(g, node, target) and must be admissible.
+// Graphs that can relax a whole adjacency row at once (soa_graph) use it instead of for_each_neighbor. Their kernels
+// compute the euclidean distance, so with them H must be euclidean_heuristic
+template<typename G>
+concept RowRelaxGraph = requires(const G &g, const double *costToCome, RelaxResult *out) {
+	g.relax_row(NodeId(), 0.0, NodeId(), costToCome, out);
+	g.max_row_size();
+};
+
+// cost returned when the search stops because it expanded nodeBudget nodes
+#define SEARCH_BUDGET_EXCEEDED (-2)
+
+// Search arrays of astar_sequential, which can be kept by the callers that solve many queries (astar_server) so that
+// a query does not allocate and clear O(V) arrays: only the nodes reached by the previous search are reset
+class astar_state {
+public:
+	std::vector<double> costToCome;
+	std::vector<NodeId> cameFrom;
+	std::vector<bool> closedSet;
+	std::vector<NodeId> reached; // nodes with a cost, to be reset before the next search
+
+	// Prepare the arrays for a search on a graph of V nodes
+	void reset(unsigned long long V) {
+		if (costToCome.size() != V) {
+			costToCome.assign(V, DBL_MAX);
+			cameFrom.assign(V, INVALID_NODE_ID);
+			closedSet.assign(V, false);
+		} else {
+			for (NodeId n: reached) {
+				costToCome[n] = DBL_MAX;
+				cameFrom[n] = INVALID_NODE_ID;
+				closedSet[n] = false;
+			}
+		}
+		reached.clear();
+	}
+};
+
+// Reconstruct path from graph and list of costs to nodes
+std::pair<double, std::vector<unsigned int>>
+reconstruct_path(unsigned int source, unsigned int target, const NodeId *cameFrom, const double *costToCome) {
+	std::vector<unsigned int> path;
+	path.emplace_back(target);
+	unsigned int current = target;
+	while (current != source) {
+		if (cameFrom[current] == INVALID_NODE_ID) {
+			std::cerr << "sequential_astar: Error during path reconstruction: Node " << current << " parent not found"
+			          << std::endl;
+			return std::make_pair(-1, path);
+		}
+		current = cameFrom[current];
+		path.emplace_back(current);
+	}
+	std::reverse(path.begin(), path.end());
+	double ret = costToCome[target];
+	return std::make_pair(ret, path);
+}
+
+// Find the best path from source to target node.
+// If more than nodeBudget nodes are expanded the search stops, returns SEARCH_BUDGET_EXCEEDED and, if frontier is not
+// null, stores in it the open nodes and the expanded ones (for their parents), so that another engine can continue
+// the search. After probeBudget expansions the search also stops if it is not expected to end within nodeBudget: the
+// progress is the fraction of h(source) covered by the expanded node closest to the target, and the expansions needed
+// are extrapolated linearly from it.
+// The search arrays are taken from state, reset at the beginning of the search
+template<typename G, typename H>
+std::pair<double, std::vector<unsigned int>>
+astar_sequential(const G &g, unsigned int source, unsigned int target, const H &h, stats &s, astar_state &state,
+                 unsigned long long nodeBudget = ULLONG_MAX, std::vector<FrontierNode> *frontier = nullptr,
+                 unsigned long long probeBudget = ULLONG_MAX) {
+	static_assert(!RowRelaxGraph<G> || std::is_same_v<H, euclidean_heuristic>,
+	              "astar_sequential: the relax kernels of a RowRelaxGraph compute the euclidean heuristic");
+	typedef std::pair<unsigned int, double> NodeFCost;
+	unsigned long long expanded = 0;
+	double sourceH = h(g, source, target), minH = sourceH;
+	std::vector<NodeId> closedNodes;
+	auto comp = [](NodeFCost a, NodeFCost b) { return a.second > b.second; };
+	std::priority_queue<NodeFCost, std::vector<NodeFCost>, decltype(comp)> openSet;
+	state.reset(num_vertices(g));
+	double *costToCome = state.costToCome.data();
+	NodeId *cameFrom = state.cameFrom.data();
+	std::vector<bool> &closedSet = state.closedSet;
+	std::vector<NodeId> &reached = state.reached;
+	std::vector<RelaxResult> relaxed;
+	if constexpr (RowRelaxGraph<G>)
+		relaxed.resize(g.max_row_size());
+
+	costToCome[source] = 0;
+	reached.push_back(source);
+	openSet.push(NodeFCost(source, 0));
+	s.startPerfCounters(0);
+
+	while (!openSet.empty()) {
+		s.updateHeapPeak(0, openSet.size());
+		NodeFCost curr_pair = openSet.top();
+		unsigned int curr = curr_pair.first;
+		openSet.pop();
+		if (curr == target) {
+			s.stopPerfCounters(0);
+			s.timeStep("Astar");
+			// Reconstructing path
+			auto path = reconstruct_path(source, target, cameFrom, costToCome);
+			s.timeStep("Path reconstruction");
+			return path;
+		}
+		if (closedSet[curr]) {
+			s.addCounter(0, COUNTER_DUPLICATES);
+			continue;
+		}
+		// h of curr, the heuristic is consistent so the fCost of the first entry of a node is never stale. The source is
+		// pushed with fCost 0
+		if (curr != source)
+			minH = std::min(minH, curr_pair.second - costToCome[curr]);
+		if (expanded == probeBudget && minH < sourceH && probeBudget * sourceH / (sourceH - minH) <= nodeBudget)
+			probeBudget = ULLONG_MAX; // on track to end within the budget
+		if (expanded == nodeBudget || expanded == probeBudget) {
+			s.stopPerfCounters(0);
+			s.timeStep("Astar");
+			if (frontier != nullptr) {
+				for (NodeId n: closedNodes)
+					frontier->emplace_back(FrontierNode{.node = n, .gCost = costToCome[n], .parent = cameFrom[n],
+					                                    .open = false});
+				// curr is still in the open set, the first entry of each node is the current one and the others
+				// (closed, or with a higher cost) are skipped
+				openSet.push(curr_pair);
+				for (; !openSet.empty(); openSet.pop()) {
+					NodeId n = openSet.top().first;
+					if (closedSet[n])
+						continue;
+					closedSet[n] = true;
+					frontier->emplace_back(FrontierNode{.node = n, .gCost = costToCome[n], .parent = cameFrom[n],
+					                                    .open = true});
+				}
+			}
+			return std::make_pair(SEARCH_BUDGET_EXCEEDED, std::vector<unsigned int>());
+		}
+		expanded++;
+		closedSet[curr] = true;
+		if (frontier != nullptr)
+			closedNodes.push_back(curr);
+		s.addNodeVisited(0);
+		if constexpr (RowRelaxGraph<G>) {
+			// only the improving neighbors are returned, the others never touch the open set. As in the generic path the
+			// neighbors that are not closed and are not pushed are duplicates: the ones not returned, and the ones
+			// returned twice by parallel edges with a cost higher than the first
+			unsigned int nImproved = g.relax_row(curr, costToCome[curr], target, costToCome, relaxed.data());
+			unsigned long long duplicates = 0;
+			for_each_neighbor(g, curr, [&](NodeId n, double) { duplicates += !closedSet[n]; });
+			for (unsigned int i = 0; i < nImproved; i++) {
+				const RelaxResult &r = relaxed[i];
+				if (closedSet[r.node])
+					continue;
+				if (r.gCost > costToCome[r.node])
+					continue;
+				duplicates--;
+				if (costToCome[r.node] == DBL_MAX)
+					reached.push_back(r.node);
+				cameFrom[r.node] = curr;
+				costToCome[r.node] = r.gCost;
+				openSet.push(NodeFCost(r.node, r.fCost));
+			}
+			s.addCounter(0, COUNTER_DUPLICATES, duplicates);
+		} else {
+			for_each_neighbor(g, curr, [&](NodeId n, double edge_w) {
+				if (closedSet[n])
+					return;
+				double gCost = costToCome[curr] + edge_w;
+				double fCost = gCost + h(g, n, target);
+				if (gCost > costToCome[n]) {
+					s.addCounter(0, COUNTER_DUPLICATES);
+					return;
+				}
+				if (costToCome[n] == DBL_MAX)
+					reached.push_back(n);
+				cameFrom[n] = curr;
+				costToCome[n] = gCost;
+				openSet.push(NodeFCost(n, fCost));
+			});
+		}
+	}
+	s.stopPerfCounters(0);
+	return std::make_pair(-1, std::vector<unsigned int>());
+}
+
+// Same search with arrays allocated for this query only
+template<typename G, typename H>
+std::pair<double, std::vector<unsigned int>>
+astar_sequential(const G &g, unsigned int source, unsigned int target, const H &h, stats &s,
+                 unsigned long long nodeBudget = ULLONG_MAX, std::vector<FrontierNode> *frontier = nullptr,
+                 unsigned long long probeBudget = ULLONG_MAX) {
+	astar_state state;
+	return astar_sequential(g, source, target, h, s, state, nodeBudget, frontier, probeBudget);
+}
+
+#endif
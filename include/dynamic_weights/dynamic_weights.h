@@ -0,0 +1,69 @@
+#ifndef DYNAMIC_WEIGHTS_H
+#define DYNAMIC_WEIGHTS_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "../graph_utils/graph_utils.h"
+
+typedef struct {
+	NodeId source;
+	NodeId target;
+	double weight;
+	double previous = 0; // weight before the update, set by weight_updates::apply_pending
+} WeightUpdate;
+
+// Double buffered batches of edge weight updates (e.g. live traffic).
+// Producers can push updates at any time, even while a query is running: they are staged in the back buffer and
+// written to the graph only by apply_pending, which is called by the searching thread itself, between two queries or
+// between two expansions (lpastar). In this way the graph is never written while it is read, and the applied batch can
+// be used to repair the result, also of the search that is running.
+class weight_updates {
+	std::mutex mutex;
+	std::vector<WeightUpdate> back;
+	std::vector<WeightUpdate> front;
+	std::atomic<bool> pending = false;
+
+public:
+	void push(const WeightUpdate &update) {
+		std::unique_lock lock(mutex);
+		back.push_back(update);
+		pending = true;
+	}
+
+	void push(const std::vector<WeightUpdate> &batch) {
+		std::unique_lock lock(mutex);
+		back.insert(back.end(), batch.begin(), batch.end());
+		pending = !back.empty();
+	}
+
+	// True if updates were pushed since the last apply_pending, cheap enough to be checked on every expansion
+	bool has_pending() const {
+		return pending;
+	}
+
+	// Swap the buffers and write the staged updates on the graph. Must be called by the thread searching on g, never
+	// by another thread while a search is running. Returns the updates applied with their previous weights, valid until
+	// the next call
+	const std::vector<WeightUpdate> &apply_pending(Graph &g) {
+		{
+			std::unique_lock lock(mutex);
+			front.clear();
+			std::swap(front, back);
+			pending = false;
+		}
+		for (auto &u: front) {
+			auto e = edge(u.source, u.target, g);
+			if (!e.second) {
+				std::cerr << "weight_updates: Edge " << u.source << "-" << u.target << " not found" << std::endl;
+				continue;
+			}
+			u.previous = get(edge_weight, g, e.first);
+			put(edge_weight, g, e.first, u.weight);
+		}
+		return front;
+	}
+};
+
+#endif
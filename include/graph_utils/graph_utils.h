@@ -3,6 +3,12 @@
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graphviz.hpp>
+#include <algorithm>
+#include <barrier>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <thread>
 
 #define LCG_MULTIPLIER 22695477
 #define LCG_INCREMENT 1
@@ -20,8 +26,18 @@ typedef unsigned int NodeId;
 typedef property<edge_weight_t, double> EdgeWeightProperty;
 typedef adjacency_list<vecS, vecS, undirectedS, VertexPosition, EdgeWeightProperty> Graph;
 
+typedef struct {
+	double seconds;
+	unsigned long long bytes;
+	double sequentialSeconds; // time of read_graph on the same file, only with COMPARE_GRAPH_LOADERS
+} GraphLoadInfo;
+
+// Time and size of the last graph loaded by read_graph, read_graph_parallel or read_grid_map
+GraphLoadInfo graphLoadInfo = {0, 0, 0};
+
 // Read graph from file. Graph should be generated from graph_generation script
 Graph read_graph(char *fin_filename) {
+	auto start = std::chrono::high_resolution_clock::now();
 	FILE *fin = fopen(fin_filename, "r");
 	if (fin == nullptr) {
 		std::cerr << "Cannot find " << fin_filename << std::endl;
@@ -31,7 +47,7 @@ Graph read_graph(char *fin_filename) {
 	fscanf(fin, "%d", &n_nodes);
 	Graph g(n_nodes);
 	double x, y;
-	for (int i = 0; i < n_nodes; i++) {
+	for (unsigned int i = 0; i < n_nodes; i++) {
 		fscanf(fin, "%lf %lf", &x, &y);
 		g[i].x = x;
 		g[i].y = y;
@@ -41,9 +57,197 @@ Graph read_graph(char *fin_filename) {
 	while (fscanf(fin, "%d %d %lf", &node1, &node2, &weight) == 3) {
 		add_edge(node1, node2, EdgeWeightProperty(weight), g);
 	}
+	graphLoadInfo.bytes = ftell(fin);
+	fclose(fin);
+	graphLoadInfo.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return g;
+}
+
+typedef struct {
+	NodeId node1;
+	NodeId node2;
+	double weight;
+} FileEdge;
+
+// Parse the next number of the line with from_chars, skipping blanks. Returns false if there is no number
+template<typename T>
+bool parse_next(const char *&p, const char *end, T &value) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	auto result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+		return false;
+	p = result.ptr;
+	return true;
+}
+
+bool is_blank_line(const char *p, const char *end) {
+	for (; p < end; p++)
+		if (*p != ' ' && *p != '\t' && *p != '\r')
+			return false;
+	return true;
+}
+
+// Read graph from file using nThreads threads. Same format and same resulting graph as read_graph.
+// The file is read in memory and split in chunks aligned to lines, one per thread. The threads are started once:
+// each counts the lines of its chunk, then after a barrier (where the first thread turns the counts into the index of
+// the first line of every chunk) it knows which lines are coordinates and which are edges, and parses them with
+// std::from_chars. The coordinates are written directly in the vertices, which are distinct for every line. The edges
+// are then added in file order through the public add_edge, since the edge list and the adjacency lists of
+// adjacency_list can only be filled safely one edge at a time
+Graph read_graph_parallel(char *fin_filename, unsigned int nThreads) {
+	auto start = std::chrono::high_resolution_clock::now();
+	std::ifstream fin(fin_filename, std::ios::binary | std::ios::ate);
+	if (!fin) {
+		std::cerr << "Cannot find " << fin_filename << std::endl;
+		exit(1);
+	}
+	size_t size = fin.tellg();
+	std::string buffer(size, '\0');
+	fin.seekg(0);
+	fin.read(buffer.data(), (std::streamsize) size);
+	fin.close();
+	const char *data = buffer.data();
+	const char *end = data + size;
+
+	// first line: number of nodes
+	const char *p = data;
+	unsigned int n_nodes = 0;
+	parse_next(p, end, n_nodes);
+	const char *bodyStart = std::find(p, end, '\n');
+	bodyStart = bodyStart == end ? end : bodyStart + 1;
+
+	// split in chunks starting at the beginning of a line
+	std::vector<const char *> bounds(nThreads + 1);
+	bounds[0] = bodyStart;
+	bounds[nThreads] = end;
+	for (unsigned int t = 1; t < nThreads; t++) {
+		const char *b = bodyStart + (end - bodyStart) * t / nThreads;
+		b = std::find(std::max(b, bounds[t - 1]), end, '\n');
+		bounds[t] = b == end ? end : b + 1;
+	}
+
+	auto for_each_line = [&](unsigned int t, auto f) {
+		for (const char *line = bounds[t]; line < bounds[t + 1];) {
+			const char *lineEnd = std::find(line, bounds[t + 1], '\n');
+			if (!is_blank_line(line, lineEnd))
+				f(line, lineEnd);
+			line = lineEnd + 1;
+		}
+	};
+
+	Graph g(n_nodes);
+	std::vector<unsigned long long> firstLine(nThreads + 1, 0);
+	std::vector<std::vector<FileEdge>> edges(nThreads);
+	// the first invalid line of each chunk is kept to be reported
+	std::vector<std::string> invalidLine(nThreads);
+	std::barrier linesCounted(nThreads);
+
+	auto worker = [&](unsigned int t) {
+		// count the lines of the chunk, the first thread then turns the counts in the index of the first line of
+		// every chunk
+		unsigned long long count = 0;
+		for_each_line(t, [&](const char *, const char *) { count++; });
+		firstLine[t + 1] = count;
+		linesCounted.arrive_and_wait();
+		if (t == 0) {
+			for (unsigned int c = 1; c <= nThreads; c++)
+				firstLine[c] += firstLine[c - 1];
+		}
+		linesCounted.arrive_and_wait();
+
+		// parse coordinates and edges
+		unsigned long long lineIndex = firstLine[t];
+		for_each_line(t, [&](const char *line, const char *lineEnd) {
+			const char *lineStart = line;
+			bool valid;
+			if (lineIndex < n_nodes) {
+				VertexPosition &pos = g[lineIndex];
+				valid = parse_next(line, lineEnd, pos.x) && parse_next(line, lineEnd, pos.y);
+			} else {
+				FileEdge e;
+				valid = parse_next(line, lineEnd, e.node1) && parse_next(line, lineEnd, e.node2)
+				        && parse_next(line, lineEnd, e.weight) && e.node1 < n_nodes && e.node2 < n_nodes;
+				if (valid)
+					edges[t].push_back(e);
+			}
+			if (!valid && invalidLine[t].empty())
+				invalidLine[t].assign(lineStart, lineEnd);
+			lineIndex++;
+		});
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < nThreads; t++)
+		threads.emplace_back(worker, t);
+	for (auto &th: threads)
+		th.join();
+
+	for (auto &line: invalidLine) {
+		if (!line.empty()) {
+			std::cerr << "Invalid line \"" << line << "\" in " << fin_filename << std::endl;
+			exit(1);
+		}
+	}
+	if (firstLine[nThreads] < n_nodes) {
+		std::cerr << "Missing coordinates in " << fin_filename << std::endl;
+		exit(1);
+	}
+
+	// the chunks are in file order, so the adjacency lists are in the same order as with read_graph
+	for (auto &chunk: edges) {
+		for (auto &e: chunk)
+			add_edge(e.node1, e.node2, EdgeWeightProperty(e.weight), g);
+		chunk = std::vector<FileEdge>();
+	}
+
+	graphLoadInfo.bytes = size;
+	graphLoadInfo.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
 	return g;
 }
 
+// True if the two graphs have the same coordinates and the same adjacency lists, in the same order
+bool same_graph(const Graph &a, const Graph &b) {
+	if (num_vertices(a) != num_vertices(b) || num_edges(a) != num_edges(b))
+		return false;
+	for (NodeId n = 0; n < num_vertices(a); n++) {
+		if (a[n].x != b[n].x || a[n].y != b[n].y || out_degree(n, a) != out_degree(n, b))
+			return false;
+		auto ea = out_edges(n, a).first, eb = out_edges(n, b).first;
+		for (; ea != out_edges(n, a).second; ++ea, ++eb) {
+			if (target(*ea, a) != target(*eb, b) || get(edge_weight, a, *ea) != get(edge_weight, b, *eb))
+				return false;
+		}
+	}
+	return true;
+}
+
+// Read graph with the loader selected at compile time: read_graph_parallel with GRAPH_LOADER_THREADS threads if
+// defined (0 = hardware concurrency), otherwise read_graph.
+// With COMPARE_GRAPH_LOADERS the graph is read first by read_graph, whose time is kept in
+// graphLoadInfo.sequentialSeconds, then by read_graph_parallel, and the two graphs must be identical
+Graph load_graph(char *fin_filename) {
+#ifdef GRAPH_LOADER_THREADS
+	unsigned int nThreads = GRAPH_LOADER_THREADS > 0 ? GRAPH_LOADER_THREADS : std::thread::hardware_concurrency();
+#ifdef COMPARE_GRAPH_LOADERS
+	Graph expected = read_graph(fin_filename);
+	double sequentialSeconds = graphLoadInfo.seconds;
+#endif
+	Graph g = read_graph_parallel(fin_filename, std::max(nThreads, 1u));
+#ifdef COMPARE_GRAPH_LOADERS
+	graphLoadInfo.sequentialSeconds = sequentialSeconds;
+	if (!same_graph(g, expected)) {
+		std::cerr << "read_graph_parallel and read_graph read different graphs from " << fin_filename << std::endl;
+		exit(1);
+	}
+	std::cerr << "Graph read in " << sequentialSeconds << " s by read_graph and in " << graphLoadInfo.seconds
+	          << " s by read_graph_parallel with " << std::max(nThreads, 1u) << " threads" << std::endl;
+#endif
+	return g;
+#else
+	return read_graph(fin_filename);
+#endif
+}
+
 // Print graph on the provided output stream using graphviz.
 // The graph that can be rendered on: https://dreampuf.github.io/GraphvizOnline
 void print_graph(Graph g, std::ostream &os) {
@@ -73,6 +277,22 @@ double calc_h_cost(const Graph &g, NodeId source, NodeId dest) {
 	return sqrt(pow(dst_x - src_x, 2) + pow(dst_y - src_y, 2));
 }
 
+// Call f(neighbor, weight) for every neighbor of n. The implicit graphs (e.g. grid_graph) provide the same function,
+// so that the templated engines can be used with any of them
+template<typename F>
+inline void for_each_neighbor(const Graph &g, NodeId n, F &&f) {
+	for (auto e: make_iterator_range(out_edges(n, g)))
+		f((NodeId) e.m_target, get(edge_weight, g, e));
+}
+
+// calc_h_cost is overloaded by the graphs with another layout of the coordinates (soa_graph)
+struct euclidean_heuristic {
+	template<typename G>
+	double operator()(const G &g, NodeId source, NodeId dest) const {
+		return calc_h_cost(g, source, dest);
+	}
+};
+
 unsigned int hash_node_id(NodeId id, unsigned int nThreads) {
 	return id % nThreads;
 }
@@ -0,0 +1,190 @@
+#ifndef GRID_GRAPH_H
+#define GRID_GRAPH_H
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../graph_utils/graph_utils.h"
+
+#define GRID_BLOCKED 0
+#define SQRT2 1.4142135623730951
+
+// Implicit graph of a 2D occupancy grid: node y * width + x is the cell (x, y) and its edges are generated on the fly
+// from the Connectivity (4 or 8) neighbors. Each cell stores a byte, 0 if blocked, otherwise the cost of crossing
+// it. Moving between two cells costs the length of the step (1 or sqrt(2)) times the average of their costs;
+// diagonal moves are allowed only if both the adjacent orthogonal cells are free (no corner cutting).
+// The grid is surrounded by a border of blocked cells, so neighbors never need bounds checks
+template<unsigned int Connectivity>
+class grid_graph {
+	static_assert(Connectivity == 4 || Connectivity == 8, "grid_graph: Connectivity must be 4 or 8");
+
+	unsigned int w, h;
+	unsigned int stride; // w + 2, row length including the border
+	std::vector<uint8_t> cells;
+	uint8_t minCost = 1;
+
+	size_t padded(NodeId n) const {
+		return (size_t) (n / w + 1) * stride + n % w + 1;
+	}
+
+public:
+	grid_graph(unsigned int width, unsigned int height) : w(width), h(height), stride(width + 2),
+	                                                      cells((size_t) (width + 2) * (height + 2), GRID_BLOCKED) {}
+
+	unsigned int width() const {
+		return w;
+	}
+
+	unsigned int height() const {
+		return h;
+	}
+
+	NodeId node(int x, int y) const {
+		return y * w + x;
+	}
+
+	int x(NodeId n) const {
+		return n % w;
+	}
+
+	int y(NodeId n) const {
+		return n / w;
+	}
+
+	// Cost of cell (x, y), with x in [-1, width] and y in [-1, height] (the border)
+	uint8_t cost(int x, int y) const {
+		return cells[(size_t) (y + 1) * stride + x + 1];
+	}
+
+	bool walkable(int x, int y) const {
+		return cost(x, y) != GRID_BLOCKED;
+	}
+
+	bool walkable(NodeId n) const {
+		return cells[padded(n)] != GRID_BLOCKED;
+	}
+
+	void set_cost(int x, int y, uint8_t c) {
+		cells[(size_t) (y + 1) * stride + x + 1] = c;
+	}
+
+	// Minimum cost of a free cell, used to keep the heuristic admissible. Must be called after the last set_cost
+	void update_min_cost() {
+		minCost = 0;
+		for (uint8_t c: cells)
+			if (c != GRID_BLOCKED && (minCost == 0 || c < minCost))
+				minCost = c;
+		if (minCost == 0)
+			minCost = 1;
+	}
+
+	uint8_t min_cost() const {
+		return minCost;
+	}
+
+	// true if every free cell has the same cost
+	bool uniform() const {
+		for (uint8_t c: cells)
+			if (c != GRID_BLOCKED && c != minCost)
+				return false;
+		return true;
+	}
+
+	// Call f(neighbor, weight) for every free neighbor of n
+	template<typename F>
+	void for_each_neighbor(NodeId n, F &&f) const {
+		size_t p = padded(n);
+		double c = cells[p];
+		const long s = stride;
+		const uint8_t e = cells[p + 1], wc = cells[p - 1], nc = cells[p - s], sc = cells[p + s];
+		if (e != GRID_BLOCKED) f(n + 1, (c + e) / 2);
+		if (wc != GRID_BLOCKED) f(n - 1, (c + wc) / 2);
+		if (nc != GRID_BLOCKED) f(n - w, (c + nc) / 2);
+		if (sc != GRID_BLOCKED) f(n + w, (c + sc) / 2);
+		if constexpr (Connectivity == 8) {
+			uint8_t d;
+			if (nc != GRID_BLOCKED && e != GRID_BLOCKED && (d = cells[p - s + 1]) != GRID_BLOCKED)
+				f(n - w + 1, SQRT2 * (c + d) / 2);
+			if (nc != GRID_BLOCKED && wc != GRID_BLOCKED && (d = cells[p - s - 1]) != GRID_BLOCKED)
+				f(n - w - 1, SQRT2 * (c + d) / 2);
+			if (sc != GRID_BLOCKED && e != GRID_BLOCKED && (d = cells[p + s + 1]) != GRID_BLOCKED)
+				f(n + w + 1, SQRT2 * (c + d) / 2);
+			if (sc != GRID_BLOCKED && wc != GRID_BLOCKED && (d = cells[p + s - 1]) != GRID_BLOCKED)
+				f(n + w - 1, SQRT2 * (c + d) / 2);
+		}
+	}
+};
+
+template<unsigned int Connectivity>
+unsigned long long num_vertices(const grid_graph<Connectivity> &g) {
+	return (unsigned long long) g.width() * g.height();
+}
+
+template<unsigned int Connectivity, typename F>
+void for_each_neighbor(const grid_graph<Connectivity> &g, NodeId n, F &&f) {
+	g.for_each_neighbor(n, f);
+}
+
+// Octile distance for 8-connected grids, manhattan distance for 4-connected grids, scaled by the cheapest cell
+struct octile_heuristic {
+	template<unsigned int Connectivity>
+	double operator()(const grid_graph<Connectivity> &g, NodeId source, NodeId dest) const {
+		double dx = std::abs(g.x(source) - g.x(dest));
+		double dy = std::abs(g.y(source) - g.y(dest));
+		if constexpr (Connectivity == 8)
+			return g.min_cost() * (dx + dy + (SQRT2 - 2) * std::min(dx, dy));
+		else
+			return g.min_cost() * (dx + dy);
+	}
+};
+
+// Read a grid in the MovingAI .map format (https://movingai.com/benchmarks/formats.html).
+// '.', 'G' and 'S' are free cells with cost 1, digits '1'-'9' are free cells with that cost, everything else is blocked
+template<unsigned int Connectivity>
+grid_graph<Connectivity> read_grid_map(char *fin_filename) {
+	auto start = std::chrono::high_resolution_clock::now();
+	std::ifstream fin(fin_filename);
+	if (!fin) {
+		std::cerr << "Cannot find " << fin_filename << std::endl;
+		exit(1);
+	}
+	std::string key;
+	unsigned int width = 0, height = 0;
+	while (fin >> key && key != "map") {
+		if (key == "height")
+			fin >> height;
+		else if (key == "width")
+			fin >> width;
+		else
+			fin >> key; // type
+	}
+	if (width == 0 || height == 0) {
+		std::cerr << "read_grid_map: Invalid header in " << fin_filename << std::endl;
+		exit(1);
+	}
+
+	grid_graph<Connectivity> g(width, height);
+	std::string line;
+	std::getline(fin, line); // end of the "map" line
+	for (unsigned int y = 0; y < height && std::getline(fin, line); y++) {
+		for (unsigned int x = 0; x < width && x < line.size(); x++) {
+			char c = line[x];
+			if (c == '.' || c == 'G' || c == 'S')
+				g.set_cost(x, y, 1);
+			else if (c >= '1' && c <= '9')
+				g.set_cost(x, y, c - '0');
+		}
+	}
+	g.update_min_cost();
+	fin.clear();
+	fin.seekg(0, std::ios::end);
+	graphLoadInfo.bytes = fin.tellg();
+	graphLoadInfo.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return g;
+}
+
+#endif
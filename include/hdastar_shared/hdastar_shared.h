@@ -0,0 +1,230 @@
+#ifndef HDASTAR_SHARED_H
+#define HDASTAR_SHARED_H
+
+#include <queue>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <cfloat>
+#include <barrier>
+#include <atomic>
+
+#include "../graph_utils/graph_utils.h"
+#include "../stats/stats.h"
+#include "../trace/trace.h"
+#include "../search_state/search_state.h"
+#include "../arena/arena.h"
+#include "../thread_pool/thread_pool.h"
+
+// Hash Distributed A* with shared memory, used by hdastar_shared and hybrid_astar
+
+#define N_THREADS 16
+#define OPEN_SET_RESERVE 4096
+// initial capacity of the path, kept across queries
+#define PATH_RESERVE 1024
+
+#define myOpenSet openSets[threadId]
+#define myOpenSetMutex openSetMutexes[threadId]
+#define myState ownedStates[threadId]
+
+
+/** types **/
+
+typedef struct {
+	NodeId node;
+	double fCost;
+} NodeFCost;
+
+const auto queue_comparator = [](const NodeFCost &a, const NodeFCost &b) { return a.fCost > b.fCost; };
+typedef arena_priority_queue<NodeFCost, decltype(queue_comparator)> OpenSet;
+
+
+/** globals **/
+
+// open sets, kept across queries with the storage of their largest search
+std::vector<std::unique_ptr<OpenSet>> openSets(N_THREADS);
+std::vector<std::mutex> openSetMutexes(N_THREADS);
+
+// cost to come and came from of the nodes owned by each thread, kept across queries
+std::vector<std::unique_ptr<ExactOwnedState>> ownedStates(N_THREADS);
+std::vector<std::mutex> costToComeMutexes(N_THREADS);
+
+// best path, written under bestPathMutex and read without it to prune the open nodes: it only decreases, so a stale
+// value only delays the pruning
+std::atomic<double> bestPathWeight = DBL_MAX;
+std::mutex bestPathMutex;
+
+// termination
+std::barrier barrier(N_THREADS);
+
+// search state left by another engine (e.g. a sequential search that exceeded its budget), the search starts from
+// its open nodes instead of the source if not null
+const std::vector<FrontierNode> *initialFrontier = nullptr;
+
+// path reconstruction
+std::vector<NodeId> path;
+//std::vector<bool> finished(N_THREADS);
+bool finished[N_THREADS];
+
+
+/** functions **/
+
+bool has_finished() {
+	for (unsigned int i = 0; i < N_THREADS; i++) {
+		if (!finished[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Lock the mutex, counting (and tracing) the acquisitions that had to wait for another thread
+void lock_counted(std::unique_lock<std::mutex> &lock, const unsigned int threadId, [[maybe_unused]] const char *name,
+                  stats &stat) {
+	if (lock.try_lock())
+		return;
+	stat.addCounter(threadId, COUNTER_LOCK_WAITS);
+	TRACE_SCOPE(threadId, name);
+	lock.lock();
+}
+
+// Search of thread threadId, templated over the graph and the heuristic like astar_sequential: G must provide
+// num_vertices(g) and for_each_neighbor(g, node, f), H is called as h(g, node, target) and must be admissible
+template<typename G, typename H>
+void hdastar_shared(const unsigned int threadId, const G &g, const NodeId &pathStart, const NodeId &pathEnd, const H &h,
+                    stats &stat) {
+	NodeFCost nfc;
+
+	// allocate open set and owned nodes from the owner thread, so that with NUMA_AWARE they are first touched on the
+	// NUMA node of the cpu the thread is pinned to. They are allocated by the first query and reused by the next ones
+	if (myOpenSet == nullptr) {
+		myOpenSet = std::make_unique<OpenSet>(queue_comparator, OPEN_SET_RESERVE);
+		myState = std::make_unique<ExactOwnedState>(num_vertices(g), N_THREADS, threadId);
+	} else {
+		myOpenSet->reset();
+		myState->reset();
+	}
+
+	// push first node and set cost to come
+	if (initialFrontier != nullptr) {
+		// every reached node keeps its cost and parent for path reconstruction, the open ones are pushed again
+		for (auto &f: *initialFrontier) {
+			if (hash_node_id(f.node, N_THREADS) != threadId)
+				continue;
+			myState->update(f.node, f.gCost, f.parent);
+			if (f.open)
+				myOpenSet->push(NodeFCost{.node = f.node, .fCost = f.gCost + h(g, f.node, pathEnd)});
+		}
+	} else if (hash_node_id(pathStart, N_THREADS) == threadId) {
+		myState->update(pathStart, 0, INVALID_NODE_ID);
+		myOpenSet->push(NodeFCost{.node = pathStart, .fCost = 0});
+	}
+	barrier.arrive_and_wait();
+	if (threadId == 0)
+		stat.timeStep("Init done");
+
+	stat.startPerfCounters(threadId);
+	while (true) {
+		// termination condition
+		std::unique_lock lock1(myOpenSetMutex, std::defer_lock);
+		lock_counted(lock1, threadId, "open set lock", stat);
+		if (myOpenSet->empty()) {
+			lock1.unlock();
+			TRACE_SCOPE(threadId, "barrier");
+			barrier.arrive_and_wait();
+			// set finished flag
+			finished[threadId] = myOpenSet->empty();
+			barrier.arrive_and_wait();
+
+			// check if all threads finished working, otherwise continue
+			if (has_finished()) {
+				stat.stopPerfCounters(threadId);
+				break;
+			} else {
+				continue;
+			}
+		}
+
+		// pop first from open set
+		stat.updateHeapPeak(threadId, myOpenSet->size());
+		nfc = myOpenSet->top();
+		myOpenSet->pop();
+		lock1.unlock();
+
+		if (nfc.fCost >= bestPathWeight) {
+			stat.addCounter(threadId, COUNTER_PRUNED);
+			continue;
+		}
+
+		// update bestPathWeight if we reached end of path
+		if (nfc.node == pathEnd) {
+			std::unique_lock lock(bestPathMutex);
+			if (nfc.fCost < bestPathWeight) {
+				bestPathWeight = nfc.fCost;
+			}
+			continue;
+		}
+
+		// iterate over neighbors
+		TRACE_SPAN(threadId, "expand");
+		double ctc;
+		{
+			std::unique_lock lock(costToComeMutexes[threadId], std::defer_lock);
+			lock_counted(lock, threadId, "cost to come lock", stat);
+			ctc = myState->getCost(nfc.node);
+		}
+		stat.addNodeVisited(threadId);
+		for_each_neighbor(g, nfc.node, [&](NodeId target, double weight) {
+			double gCost = ctc + weight;
+			double fCost = gCost + h(g, target, pathEnd);
+
+			if (fCost < bestPathWeight) {
+				unsigned int targetThread = hash_node_id(target, N_THREADS);
+				std::unique_lock lock(costToComeMutexes[targetThread], std::defer_lock);
+				lock_counted(lock, threadId, "cost to come lock", stat);
+				if (ownedStates[targetThread]->getCost(target) > gCost) {
+					ownedStates[targetThread]->update(target, gCost, nfc.node);
+					lock.unlock();
+					{
+						std::unique_lock lock2(openSetMutexes[targetThread], std::defer_lock);
+						lock_counted(lock2, threadId, "open set lock", stat);
+						openSets[targetThread]->push(NodeFCost{.node = target, .fCost = fCost});
+					}
+				} else {
+					stat.addCounter(threadId, COUNTER_DUPLICATES);
+				}
+			} else {
+				stat.addCounter(threadId, COUNTER_PRUNED);
+			}
+		});
+	}
+}
+
+template<typename G>
+int path_reconstruction([[maybe_unused]] const G &g, const NodeId &pathStart, const NodeId &pathEnd,
+                        [[maybe_unused]] stats &stat) {
+	NodeId curr = pathEnd;
+	while (true) {
+		path.insert(path.begin(), curr);
+
+		if (curr == pathStart)
+			return 0;
+
+		NodeId parent = ownedStates[hash_node_id(curr, N_THREADS)]->getParent(curr);
+		if (parent == INVALID_NODE_ID) {
+			std::cerr << "hdastar_shared: Error during path reconstruction: Node " << curr << " parent not found"
+			          << std::endl;
+			return 1;
+		}
+		curr = parent;
+	}
+}
+
+// Reset the globals before the next search, open sets and owned nodes are kept and reset by their threads
+void hdastar_shared_cleanup() {
+	bestPathWeight = DBL_MAX;
+	initialFrontier = nullptr;
+	path.clear();
+}
+
+#endif
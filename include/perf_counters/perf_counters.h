@@ -0,0 +1,136 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <iostream>
+#include <string>
+
+#ifdef ENABLE_PERF_COUNTERS
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+typedef enum {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_NODE_MISSES, // accesses served by the memory of a remote NUMA node
+	PERF_N_EVENTS
+} PerfEvent;
+
+const char *const perfEventNames[PERF_N_EVENTS] = {"cycles", "instructions", "L1D misses", "LLC misses",
+                                                   "branch misses", "NUMA node misses"};
+
+// Hardware counters of the calling thread, collected with perf_event_open.
+// Compiled to a no-op returning zeros unless ENABLE_PERF_COUNTERS is defined, or if the kernel refuses the events
+// (e.g. perf_event_paranoid too high or running in a VM without a PMU)
+class perf_counters {
+	int fds[PERF_N_EVENTS];
+	unsigned long long values[PERF_N_EVENTS];
+
+#ifdef ENABLE_PERF_COUNTERS
+	// errno of the failed perf_event_open of each event
+	int errors[PERF_N_EVENTS];
+
+	void open_event(PerfEvent event, unsigned int type, unsigned long long config) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// pid = 0, cpu = -1: count the calling thread on any cpu
+		fds[event] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		errors[event] = fds[event] == -1 ? errno : 0;
+	}
+
+	static unsigned long long cache_miss_config(unsigned long long cache) {
+		return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	}
+#endif
+
+public:
+	perf_counters() {
+		for (int i = 0; i < PERF_N_EVENTS; i++) {
+			fds[i] = -1;
+			values[i] = 0;
+#ifdef ENABLE_PERF_COUNTERS
+			errors[i] = 0;
+#endif
+		}
+	}
+
+	perf_counters(const perf_counters &) = delete;
+	perf_counters &operator=(const perf_counters &) = delete;
+
+	~perf_counters() {
+		close_all();
+	}
+
+	// Open and enable the counters. Must be called by the thread to be measured
+	void start() {
+#ifdef ENABLE_PERF_COUNTERS
+		close_all();
+		open_event(PERF_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		open_event(PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		open_event(PERF_L1D_MISSES, PERF_TYPE_HW_CACHE, cache_miss_config(PERF_COUNT_HW_CACHE_L1D));
+		open_event(PERF_LLC_MISSES, PERF_TYPE_HW_CACHE, cache_miss_config(PERF_COUNT_HW_CACHE_LL));
+		open_event(PERF_BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+		open_event(PERF_NODE_MISSES, PERF_TYPE_HW_CACHE, cache_miss_config(PERF_COUNT_HW_CACHE_NODE));
+		for (int i = 0; i < PERF_N_EVENTS; i++) {
+			values[i] = 0;
+			if (fds[i] == -1) {
+				// every worker thread calls start() at the same time, only the first one warns
+				static std::atomic<bool> warned = false;
+				if (!warned.exchange(true)) {
+					std::cerr << "perf_counters: Cannot open event " << perfEventNames[i] << ": "
+					          << strerror(errors[i]) << std::endl;
+				}
+				continue;
+			}
+			ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	// Disable the counters and store their values
+	void stop() {
+#ifdef ENABLE_PERF_COUNTERS
+		for (int i = 0; i < PERF_N_EVENTS; i++) {
+			if (fds[i] == -1)
+				continue;
+			ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+				values[i] = 0;
+		}
+		close_all();
+#endif
+	}
+
+	unsigned long long get(PerfEvent event) const {
+		return values[event];
+	}
+
+private:
+	void close_all() {
+		for (int i = 0; i < PERF_N_EVENTS; i++) {
+			if (fds[i] != -1) {
+#ifdef ENABLE_PERF_COUNTERS
+				close(fds[i]);
+#endif
+				fds[i] = -1;
+			}
+		}
+	}
+};
+
+#endif
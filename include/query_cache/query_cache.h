@@ -0,0 +1,205 @@
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <algorithm>
+#include <cfloat>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../graph_utils/graph_utils.h"
+#include "../dynamic_weights/dynamic_weights.h"
+
+typedef struct {
+	NodeId source;
+	NodeId dest;
+	double cost;
+	std::vector<NodeId> path;
+	std::vector<double> costToCome; // cost from source to every node of the path
+} CachedPath;
+
+// Bounded LRU cache of (source, dest) -> (cost, path), safe to use from multiple threads.
+// After a batch of weight updates (see weight_updates::apply_pending) invalidate drops only the paths that may no
+// longer be optimal: the ones using an updated edge, or all of them if a weight decreased.
+//
+// With subpath reuse every suffix of a cached path is also indexed: since the path is optimal, the path from any of
+// its nodes to dest is optimal too, so the query (path[i], dest) can be answered without searching.
+// The capacity bounds the (source, dest) pairs that can be answered, suffixes included: the least recently used paths
+// are evicted together with their suffixes until the new path fits
+class query_cache {
+	typedef unsigned long long Key;
+	typedef std::list<std::shared_ptr<CachedPath>>::iterator LruIterator;
+
+	std::mutex mutex;
+	unsigned int capacity;
+	bool subpathReuse;
+	std::list<std::shared_ptr<CachedPath>> lru; // most recently used first
+	std::unordered_map<Key, LruIterator> entries;
+	std::unordered_map<Key, std::pair<CachedPath *, unsigned int>> suffixes; // (node, dest) -> (path, node position)
+
+	unsigned long long hits = 0;
+	unsigned long long subpathHits = 0;
+	unsigned long long misses = 0;
+	unsigned long long invalidations = 0;
+	unsigned long long evictions = 0;
+
+	static Key make_key(NodeId source, NodeId dest) {
+		return ((Key) source << 32) | dest;
+	}
+
+	// the graph is undirected, both directions of an edge have the same key
+	static Key make_edge_key(NodeId a, NodeId b) {
+		return make_key(std::min(a, b), std::max(a, b));
+	}
+
+	// Weight of the cheapest of the parallel edges between a and b, which is the one relaxed by the search that found
+	// an optimal path through them
+	static double edge_cost(const Graph &g, NodeId a, NodeId b) {
+		double cost = DBL_MAX;
+		for (auto e: make_iterator_range(out_edges(a, g))) {
+			if (e.m_target == b)
+				cost = std::min(cost, get(edge_weight, g, e));
+		}
+		return cost;
+	}
+
+	// Remove a path together with its suffixes, returns the next path in LRU order
+	LruIterator erase(LruIterator it) {
+		CachedPath *erased = it->get();
+		entries.erase(make_key(erased->source, erased->dest));
+		if (subpathReuse) {
+			for (NodeId n: erased->path) {
+				auto sit = suffixes.find(make_key(n, erased->dest));
+				if (sit != suffixes.end() && sit->second.first == erased)
+					suffixes.erase(sit);
+			}
+		}
+		return lru.erase(it);
+	}
+
+	void evict_last() {
+		erase(std::prev(lru.end()));
+		evictions++;
+	}
+
+	unsigned long long size() const {
+		return entries.size() + suffixes.size();
+	}
+
+public:
+	query_cache(unsigned int capacity, bool subpathReuse) : capacity(capacity), subpathReuse(subpathReuse) {}
+
+	bool enabled() const {
+		return capacity > 0;
+	}
+
+	// Look for the path from source to dest, returns false on miss
+	bool lookup(NodeId source, NodeId dest, double &cost, std::vector<NodeId> &path) {
+		if (!enabled())
+			return false;
+		std::unique_lock lock(mutex);
+
+		auto it = entries.find(make_key(source, dest));
+		if (it != entries.end()) {
+			// move to front
+			lru.splice(lru.begin(), lru, it->second);
+			cost = (*it->second)->cost;
+			path = (*it->second)->path;
+			hits++;
+			return true;
+		}
+
+		if (subpathReuse) {
+			auto sit = suffixes.find(make_key(source, dest));
+			if (sit != suffixes.end()) {
+				CachedPath *cached = sit->second.first;
+				unsigned int position = sit->second.second;
+				auto owner = entries.find(make_key(cached->source, cached->dest));
+				if (owner != entries.end()) {
+					cost = cached->cost - cached->costToCome[position];
+					path.assign(cached->path.begin() + position, cached->path.end());
+					lru.splice(lru.begin(), lru, owner->second);
+					subpathHits++;
+					return true;
+				}
+				// every suffix is removed together with its path, this is never reached
+				suffixes.erase(sit);
+			}
+		}
+
+		misses++;
+		return false;
+	}
+
+	void insert(const Graph &g, double cost, const std::vector<NodeId> &path) {
+		if (!enabled() || path.empty())
+			return;
+		std::unique_lock lock(mutex);
+
+		Key key = make_key(path.front(), path.back());
+		if (entries.contains(key))
+			return;
+		// a path longer than the capacity is indexed only up to the capacity
+		unsigned long long nSuffixes = subpathReuse && path.size() > 2 ? path.size() - 2 : 0;
+		nSuffixes = std::min(nSuffixes, (unsigned long long) capacity - 1);
+		while (!lru.empty() && size() + 1 + nSuffixes > capacity)
+			evict_last();
+
+		auto cached = std::make_shared<CachedPath>(CachedPath{.source = path.front(), .dest = path.back(),
+		                                                      .cost = cost, .path = path, .costToCome = {}});
+		if (subpathReuse) {
+			cached->costToCome.resize(path.size());
+			cached->costToCome[0] = 0;
+			for (unsigned int i = 1; i < path.size(); i++)
+				cached->costToCome[i] = cached->costToCome[i - 1] + edge_cost(g, path[i - 1], path[i]);
+			for (unsigned int i = 1; i <= nSuffixes; i++)
+				suffixes[make_key(path[i], cached->dest)] = std::make_pair(cached.get(), i);
+		}
+		lru.push_front(cached);
+		entries[key] = lru.begin();
+	}
+
+	// Drop the paths that may no longer be optimal after the updates applied on the graph: the paths using an updated
+	// edge or, if a weight decreased, all of them since a cheaper path may now exist anywhere
+	void invalidate(const std::vector<WeightUpdate> &applied) {
+		if (!enabled() || applied.empty())
+			return;
+		std::unique_lock lock(mutex);
+		if (std::any_of(applied.begin(), applied.end(), [](const WeightUpdate &u) { return u.weight < u.previous; })) {
+			invalidations += lru.size();
+			lru.clear();
+			entries.clear();
+			suffixes.clear();
+			return;
+		}
+		std::unordered_set<Key> updated;
+		for (auto &u: applied)
+			updated.insert(make_edge_key(u.source, u.target));
+		for (auto it = lru.begin(); it != lru.end();) {
+			const std::vector<NodeId> &path = (*it)->path;
+			bool touched = false;
+			for (unsigned int i = 1; i < path.size() && !touched; i++)
+				touched = updated.contains(make_edge_key(path[i - 1], path[i]));
+			if (touched) {
+				it = erase(it);
+				invalidations++;
+			} else {
+				it++;
+			}
+		}
+	}
+
+	void print_stats(std::ostream &os) {
+		std::unique_lock lock(mutex);
+		unsigned long long lookups = hits + subpathHits + misses;
+		os << "Query cache: capacity " << capacity << ", subpaths " << (subpathReuse ? "on" : "off") << ", " << hits
+		   << " hits, " << subpathHits << " subpath hits, " << misses << " misses, "
+		   << invalidations << " invalidations, " << evictions << " evictions, hit rate "
+		   << (lookups ? (double) (hits + subpathHits) / lookups : 0) << std::endl;
+	}
+};
+
+#endif
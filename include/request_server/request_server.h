@@ -0,0 +1,158 @@
+#ifndef REQUEST_SERVER_H
+#define REQUEST_SERVER_H
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Line based protocol of astar_server, every line ends with '\n':
+// - server -> client, once after connecting: "NODES <number of nodes>"
+// - client -> server: "<id> <source> <dest>"
+// - server -> client: "<id> <cost> <steps> <node>-<node>-...-<node>", cost -1 and no path if there is none
+// - client -> server: "STATS", answered with "STATS <statistics of the query cache>"
+// Responses of the same connection can arrive in any order, the id is chosen by the client.
+//
+// ADDRESS is the path of a unix domain socket, or a port number to use TCP on localhost
+
+#define REQUEST_SERVER_BACKLOG 64
+#define MAX_TCP_PORT 65535
+
+bool is_tcp_address(const std::string &address) {
+	return !address.empty() && std::all_of(address.begin(), address.end(), [](unsigned char c) {
+		return std::isdigit(c);
+	});
+}
+
+// Port number of a tcp address, prints an error and returns -1 if it is not between 1 and MAX_TCP_PORT
+int tcp_port(const std::string &address) {
+	int port = 0;
+	for (char c: address) {
+		port = port * 10 + (c - '0');
+		if (port > MAX_TCP_PORT)
+			break;
+	}
+	if (port < 1 || port > MAX_TCP_PORT) {
+		std::cerr << "Invalid port " << address << ", it must be between 1 and " << MAX_TCP_PORT << std::endl;
+		return -1;
+	}
+	return port;
+}
+
+// Create a listening socket, returns -1 on error
+int listen_address(const std::string &address) {
+	int fd;
+	if (is_tcp_address(address)) {
+		int port = tcp_port(address);
+		if (port < 0)
+			return -1;
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		int one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (fd < 0 || bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+			std::cerr << "Cannot bind port " << address << ": " << strerror(errno) << std::endl;
+			return -1;
+		}
+	} else {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+		unlink(address.c_str()); // socket left by a previous run
+		if (fd < 0 || bind(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+			std::cerr << "Cannot bind " << address << ": " << strerror(errno) << std::endl;
+			return -1;
+		}
+	}
+	if (listen(fd, REQUEST_SERVER_BACKLOG) < 0) {
+		std::cerr << "Cannot listen on " << address << ": " << strerror(errno) << std::endl;
+		return -1;
+	}
+	return fd;
+}
+
+// Connect to a server, returns -1 on error
+int connect_address(const std::string &address) {
+	int fd;
+	int result;
+	if (is_tcp_address(address)) {
+		int port = tcp_port(address);
+		if (port < 0)
+			return -1;
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		result = connect(fd, (sockaddr *) &addr, sizeof(addr));
+	} else {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+		result = connect(fd, (sockaddr *) &addr, sizeof(addr));
+	}
+	if (fd < 0 || result < 0) {
+		std::cerr << "Cannot connect to " << address << ": " << strerror(errno) << std::endl;
+		return -1;
+	}
+	return fd;
+}
+
+// Write the whole buffer, returns false if the connection was closed
+bool write_all(int fd, const std::string &data) {
+	size_t sent = 0;
+	while (sent < data.size()) {
+		ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (n <= 0)
+			return false;
+		sent += n;
+	}
+	return true;
+}
+
+// Reads the lines received on a socket
+class line_reader {
+	int fd;
+	std::string buffer;
+	size_t start = 0;
+
+public:
+	explicit line_reader(int fd) : fd(fd) {}
+
+	// Returns false when the connection is closed
+	bool next(std::string &line) {
+		while (true) {
+			size_t end = buffer.find('\n', start);
+			if (end != std::string::npos) {
+				line.assign(buffer, start, end - start);
+				start = end + 1;
+				return true;
+			}
+			buffer.erase(0, start);
+			start = 0;
+			char chunk[4096];
+			ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+			if (n <= 0)
+				return false;
+			buffer.append(chunk, n);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef SEARCH_STATE_H
+#define SEARCH_STATE_H
+
+#include <cfloat>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "../graph_utils/graph_utils.h"
+
+// Cost to come and parent of the nodes owned by a single thread, where a thread owns the nodes with
+// hash_node_id(id, nThreads) == threadId.
+//
+// Compile time options:
+// - COMPACT_FLOAT_COSTS: store costs as float instead of double (8 bytes per node instead of 12)
+// - SPARSE_SEARCH_STATE: store only the nodes reached by the search in a hash table, for small searches on huge
+//   graphs. Otherwise every owned node has a slot in a dense array
+
+#ifdef COMPACT_FLOAT_COSTS
+typedef float Cost;
+#define COST_MAX FLT_MAX
+#else
+typedef double Cost;
+#define COST_MAX DBL_MAX
+#endif
+
+// Node reached by a search, used to continue the search with another engine
+typedef struct {
+	NodeId node;
+	double gCost;
+	NodeId parent;
+	bool open; // reached but not expanded yet
+} FrontierNode;
+
+// hash_node_id assigns nodes round robin, so the owned nodes of a thread are threadId, threadId + nThreads, ...
+// and can be stored at index id / nThreads.
+// The cost type is a template parameter so that the engines not affected by COMPACT_FLOAT_COSTS can keep double costs
+template<typename C>
+class basic_dense_owned_state {
+	unsigned int nThreads;
+	std::vector<C> costToCome;
+	std::vector<NodeId> cameFrom;
+
+public:
+	basic_dense_owned_state(unsigned int nNodes, unsigned int nThreads, unsigned int threadId) : nThreads(nThreads) {
+		unsigned int nOwned = nNodes / nThreads + (threadId < nNodes % nThreads ? 1 : 0);
+		costToCome = std::vector<C>(nOwned, std::numeric_limits<C>::max());
+		cameFrom = std::vector<NodeId>(nOwned, INVALID_NODE_ID);
+	}
+
+	C getCost(NodeId id) const {
+		return costToCome[id / nThreads];
+	}
+
+	NodeId getParent(NodeId id) const {
+		return cameFrom[id / nThreads];
+	}
+
+	void update(NodeId id, C cost, NodeId parent) {
+		costToCome[id / nThreads] = cost;
+		cameFrom[id / nThreads] = parent;
+	}
+
+	// Forget every node before a new query, keeping the arrays
+	void reset() {
+		std::fill(costToCome.begin(), costToCome.end(), std::numeric_limits<C>::max());
+		std::fill(cameFrom.begin(), cameFrom.end(), INVALID_NODE_ID);
+	}
+};
+
+typedef basic_dense_owned_state<Cost> dense_owned_state;
+
+class sparse_owned_state {
+	typedef struct {
+		Cost costToCome;
+		NodeId cameFrom;
+	} NodeState;
+
+	std::unordered_map<NodeId, NodeState> nodes;
+
+public:
+	// same parameters as dense_owned_state, the table grows with the reached nodes
+	sparse_owned_state([[maybe_unused]] unsigned int nNodes, [[maybe_unused]] unsigned int nThreads,
+	                   [[maybe_unused]] unsigned int threadId) {}
+
+	Cost getCost(NodeId id) const {
+		auto it = nodes.find(id);
+		return it == nodes.end() ? COST_MAX : it->second.costToCome;
+	}
+
+	NodeId getParent(NodeId id) const {
+		auto it = nodes.find(id);
+		return it == nodes.end() ? INVALID_NODE_ID : it->second.cameFrom;
+	}
+
+	void update(NodeId id, Cost cost, NodeId parent) {
+		nodes[id] = NodeState{.costToCome = cost, .cameFrom = parent};
+	}
+
+	// Forget every node before a new query, keeping the buckets of the table
+	void reset() {
+		nodes.clear();
+	}
+};
+
+// state of hdastar_message_passing, selected by the compile time options
+#ifdef SPARSE_SEARCH_STATE
+typedef sparse_owned_state OwnedState;
+#else
+typedef dense_owned_state OwnedState;
+#endif
+
+// state of the other parallel engines, always dense with double costs
+typedef basic_dense_owned_state<double> ExactOwnedState;
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef SOA_GRAPH_H
+#define SOA_GRAPH_H
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SOA_GRAPH_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#include "../graph_utils/graph_utils.h"
+
+// rows are padded to a multiple of 8 edges, the number of doubles in an AVX-512 register, and start on a cache line
+#define SOA_ROW_ALIGNMENT 8
+
+// Allocator of cache line aligned arrays, so that every padded row can be loaded with aligned SIMD loads
+template<typename T>
+struct aligned_allocator {
+	typedef T value_type;
+
+	aligned_allocator() = default;
+
+	template<typename U>
+	aligned_allocator(const aligned_allocator<U> &) {}
+
+	T *allocate(size_t n) {
+		return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(64)));
+	}
+
+	void deallocate(T *p, size_t) {
+		::operator delete(p, std::align_val_t(64));
+	}
+
+	bool operator==(const aligned_allocator &) const { return true; }
+};
+
+template<typename T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+typedef struct {
+	NodeId node;
+	double gCost;
+	double fCost;
+} RelaxResult;
+
+// Adjacency row of a vertex, size edges followed by padding up to a multiple of SOA_ROW_ALIGNMENT.
+// Padding edges point to the vertex itself with infinite weight, so they are never improving
+typedef struct {
+	const NodeId *neighbors;
+	const double *weights;
+	const double *x; // coordinates of every node, indexed by the neighbor ids
+	const double *y;
+	unsigned int size;
+	unsigned int paddedSize;
+} SoaRow;
+
+// Relax kernels: compute gCost = g + weight, h (euclidean distance to the target) and fCost for every edge of the row
+// and store in out only the neighbors with gCost <= costToCome[neighbor], the ties are pushed like in the generic path
+// of astar_sequential. Return the number of results
+typedef unsigned int (*RelaxKernel)(const SoaRow &row, double g, double tx, double ty, const double *costToCome,
+                                    RelaxResult *out);
+
+unsigned int relax_row_scalar(const SoaRow &row, double g, double tx, double ty, const double *costToCome,
+                              RelaxResult *out) {
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < row.size; i++) {
+		double gCost = g + row.weights[i];
+		if (gCost <= costToCome[row.neighbors[i]]) {
+			double dx = tx - row.x[row.neighbors[i]], dy = ty - row.y[row.neighbors[i]];
+			out[n++] = RelaxResult{.node = row.neighbors[i], .gCost = gCost, .fCost = gCost + sqrt(dx * dx + dy * dy)};
+		}
+	}
+	return n;
+}
+
+#ifdef SOA_GRAPH_X86_KERNELS
+__attribute__((target("avx2")))
+unsigned int relax_row_avx2(const SoaRow &row, double g, double tx, double ty, const double *costToCome,
+                            RelaxResult *out) {
+	unsigned int n = 0;
+	const __m256d vg = _mm256_set1_pd(g), vtx = _mm256_set1_pd(tx), vty = _mm256_set1_pd(ty);
+	const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+	alignas(32) double gCosts[4], fCosts[4];
+	for (unsigned int i = 0; i < row.paddedSize; i += 4) {
+		__m256d gCost = _mm256_add_pd(vg, _mm256_load_pd(row.weights + i));
+		__m128i idx = _mm_load_si128((const __m128i *) (row.neighbors + i));
+		// masked gather with an explicit source, the unmasked one triggers a false uninitialized warning in gcc
+		__m256d old = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), costToCome, idx, allLanes, 8);
+		int mask = _mm256_movemask_pd(_mm256_cmp_pd(gCost, old, _CMP_LE_OQ));
+		if (mask == 0)
+			continue;
+		__m256d dx = _mm256_sub_pd(vtx, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), row.x, idx, allLanes, 8));
+		__m256d dy = _mm256_sub_pd(vty, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), row.y, idx, allLanes, 8));
+		__m256d h = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+		_mm256_store_pd(gCosts, gCost);
+		_mm256_store_pd(fCosts, _mm256_add_pd(gCost, h));
+		while (mask) {
+			int lane = __builtin_ctz(mask);
+			mask &= mask - 1;
+			out[n++] = RelaxResult{.node = row.neighbors[i + lane], .gCost = gCosts[lane], .fCost = fCosts[lane]};
+		}
+	}
+	return n;
+}
+
+__attribute__((target("avx512f")))
+unsigned int relax_row_avx512(const SoaRow &row, double g, double tx, double ty, const double *costToCome,
+                              RelaxResult *out) {
+	unsigned int n = 0;
+	const __m512d vg = _mm512_set1_pd(g), vtx = _mm512_set1_pd(tx), vty = _mm512_set1_pd(ty);
+	alignas(64) double gCosts[8], fCosts[8];
+	for (unsigned int i = 0; i < row.paddedSize; i += 8) {
+		__m512d gCost = _mm512_add_pd(vg, _mm512_load_pd(row.weights + i));
+		__m256i idx = _mm256_load_si256((const __m256i *) (row.neighbors + i));
+		__m512d old = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, idx, costToCome, 8);
+		__mmask8 mask = _mm512_cmp_pd_mask(gCost, old, _CMP_LE_OQ);
+		if (mask == 0)
+			continue;
+		// coordinates are gathered only for the improving lanes
+		__m512d dx = _mm512_sub_pd(vtx, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, idx, row.x, 8));
+		__m512d dy = _mm512_sub_pd(vty, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, idx, row.y, 8));
+		__m512d h = _mm512_maskz_sqrt_pd(0xFF, _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)));
+		_mm512_store_pd(gCosts, gCost);
+		_mm512_store_pd(fCosts, _mm512_add_pd(gCost, h));
+		unsigned int m = mask;
+		while (m) {
+			int lane = __builtin_ctz(m);
+			m &= m - 1;
+			out[n++] = RelaxResult{.node = row.neighbors[i + lane], .gCost = gCosts[lane], .fCost = fCosts[lane]};
+		}
+	}
+	return n;
+}
+#endif
+
+typedef std::pair<const char *, RelaxKernel> NamedRelaxKernel;
+
+// Kernels supported by the cpu, from the scalar one to the widest
+std::vector<NamedRelaxKernel> supported_relax_kernels() {
+	std::vector<NamedRelaxKernel> kernels = {{"scalar", relax_row_scalar}};
+#ifdef SOA_GRAPH_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		kernels.emplace_back("avx2", relax_row_avx2);
+	if (__builtin_cpu_supports("avx512f"))
+		kernels.emplace_back("avx512", relax_row_avx512);
+#endif
+	return kernels;
+}
+
+// Pick the widest kernel supported by the cpu
+RelaxKernel select_relax_kernel(const char *&name) {
+	NamedRelaxKernel widest = supported_relax_kernels().back();
+	name = widest.first;
+	return widest.second;
+}
+
+// Structure of arrays copy of a Graph: the neighbor ids and weights of each vertex are stored contiguously in separate
+// arrays, so that a whole row can be relaxed with SIMD instructions (see relax_row). The coordinates are stored once
+// per node and gathered by the kernels only for the improving neighbors
+class soa_graph {
+	std::vector<unsigned long long> rowStart;
+	std::vector<unsigned int> degree;
+	aligned_vector<NodeId> neighbors;
+	aligned_vector<double> weights;
+	std::vector<double> x;
+	std::vector<double> y;
+	unsigned int maxPaddedDegree = 0;
+	RelaxKernel kernel;
+	const char *kernelName;
+
+public:
+	explicit soa_graph(const Graph &g) {
+		unsigned int N = num_vertices(g);
+		rowStart.resize(N + 1);
+		degree.resize(N);
+		x.resize(N);
+		y.resize(N);
+		rowStart[0] = 0;
+		for (NodeId n = 0; n < N; n++) {
+			degree[n] = out_degree(n, g);
+			unsigned int padded = (degree[n] + SOA_ROW_ALIGNMENT - 1) / SOA_ROW_ALIGNMENT * SOA_ROW_ALIGNMENT;
+			maxPaddedDegree = std::max(maxPaddedDegree, padded);
+			rowStart[n + 1] = rowStart[n] + padded;
+			x[n] = g[n].x;
+			y[n] = g[n].y;
+		}
+		neighbors.resize(rowStart[N]);
+		weights.resize(rowStart[N], std::numeric_limits<double>::infinity());
+		for (NodeId n = 0; n < N; n++) {
+			unsigned long long i = rowStart[n];
+			for (auto e: make_iterator_range(out_edges(n, g))) {
+				neighbors[i] = e.m_target;
+				weights[i] = get(edge_weight, g, e);
+				i++;
+			}
+			for (; i < rowStart[n + 1]; i++)
+				neighbors[i] = n;
+		}
+		kernel = select_relax_kernel(kernelName);
+	}
+
+	unsigned int num_nodes() const {
+		return degree.size();
+	}
+
+	// Size of the output buffer needed by relax_row
+	unsigned int max_row_size() const {
+		return maxPaddedDegree;
+	}
+
+	const char *kernel_name() const {
+		return kernelName;
+	}
+
+	double node_x(NodeId n) const {
+		return x[n];
+	}
+
+	double node_y(NodeId n) const {
+		return y[n];
+	}
+
+	SoaRow row(NodeId n) const {
+		unsigned long long start = rowStart[n];
+		return SoaRow{.neighbors = neighbors.data() + start, .weights = weights.data() + start, .x = x.data(),
+		              .y = y.data(), .size = degree[n], .paddedSize = (unsigned int) (rowStart[n + 1] - start)};
+	}
+
+	// Relax every edge of n, reached with cost g, towards target. costToCome must have an entry for every node
+	unsigned int relax_row(NodeId n, double g, NodeId target, const double *costToCome, RelaxResult *out) const {
+		return kernel(row(n), g, x[target], y[target], costToCome, out);
+	}
+
+	// Run every kernel supported by the cpu on every row and compare its results with the scalar kernel. The rows are
+	// relaxed with g = 0 and the costs to come are chosen so that only part of the neighbors improve: a third of the
+	// nodes are unreached, a third have the weight of one of their edges (a tie, returned) and the others an
+	// arbitrary cost. fCost can differ in the last bits, since the compiler can fuse the multiply and add of the
+	// vector kernels. Returns the name of the first kernel that differs, nullptr if they all agree
+	const char *check_kernels() const {
+		unsigned int N = num_nodes();
+		std::vector<double> costToCome(N, -1);
+		for (NodeId n = 0; n < N; n++) {
+			for (unsigned long long i = rowStart[n]; i < rowStart[n] + degree[n]; i++)
+				if (neighbors[i] % 3 == 1 && costToCome[neighbors[i]] < 0)
+					costToCome[neighbors[i]] = weights[i];
+		}
+		for (NodeId n = 0; n < N; n++) {
+			if (n % 3 == 0)
+				costToCome[n] = std::numeric_limits<double>::max();
+			else if (n % 3 == 2 || costToCome[n] < 0)
+				costToCome[n] = n % 7 * (x[n] + y[n]) / 1000;
+		}
+		std::vector<RelaxResult> expected(maxPaddedDegree), actual(maxPaddedDegree);
+		for (auto &k: supported_relax_kernels()) {
+			for (NodeId n = 0; n < N; n++) {
+				NodeId target = (n + 1) % N;
+				unsigned int nExpected = relax_row_scalar(row(n), 0, x[target], y[target], costToCome.data(),
+				                                          expected.data());
+				if (k.second(row(n), 0, x[target], y[target], costToCome.data(), actual.data()) != nExpected)
+					return k.first;
+				for (unsigned int i = 0; i < nExpected; i++) {
+					if (actual[i].node != expected[i].node || actual[i].gCost != expected[i].gCost
+					    || std::abs(actual[i].fCost - expected[i].fCost) > 1e-12 * std::max(1.0, expected[i].fCost))
+						return k.first;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	template<typename F>
+	void for_each_neighbor(NodeId n, F &&f) const {
+		SoaRow r = row(n);
+		for (unsigned int i = 0; i < r.size; i++)
+			f(r.neighbors[i], r.weights[i]);
+	}
+};
+
+inline unsigned long long num_vertices(const soa_graph &g) {
+	return g.num_nodes();
+}
+
+template<typename F>
+void for_each_neighbor(const soa_graph &g, NodeId n, F &&f) {
+	g.for_each_neighbor(n, f);
+}
+
+// Same euclidean distance computed by the relax kernels, used by euclidean_heuristic outside of them
+double calc_h_cost(const soa_graph &g, NodeId source, NodeId dest) {
+	double dx = g.node_x(dest) - g.node_x(source), dy = g.node_y(dest) - g.node_y(source);
+	return sqrt(dx * dx + dy * dy);
+}
+
+#endif
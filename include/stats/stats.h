@@ -6,12 +6,53 @@
 #include <fstream>
 #include <atomic>
 #include <numeric>
+#include <string_view>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
 
 #include "../graph_utils/graph_utils.h"
+#include "../perf_counters/perf_counters.h"
+#include "../arena/arena.h"
 
 using namespace std::chrono;
 
-typedef std::pair<high_resolution_clock::time_point, std::string> TimePointPair;
+// the step names are string literals, so they are not copied
+typedef std::pair<high_resolution_clock::time_point, std::string_view> TimePointPair;
+
+typedef enum {
+	COUNTER_EXPANDED, // nodes expanded
+	COUNTER_DUPLICATES, // nodes discarded because already reached with a lower cost
+	COUNTER_PRUNED, // nodes discarded because their fCost is not lower than the best path found
+	COUNTER_MESSAGES_SENT,
+	COUNTER_MESSAGES_RECEIVED,
+	COUNTER_LOCK_WAITS, // lock acquisitions that found the lock already taken
+	N_COUNTERS
+} Counter;
+
+const char *const counterNames[N_COUNTERS] = {"expanded", "duplicates", "pruned", "messages sent",
+                                              "messages received", "lock waits"};
+
+// Counters of a single thread. Each thread writes only its own block, aligned to a cache line so that the blocks of
+// different threads never share a line
+typedef struct alignas(64) {
+	unsigned long long counters[N_COUNTERS];
+	unsigned long long heapPeak;
+	perf_counters perfCounters;
+} ThreadStats;
+
+// Peak resident set size of the process in KB, 0 if not available.
+// ru_maxrss is the high-water mark since the process started and never decreases, so it is not the memory used by
+// the last query
+long peak_rss_kb() {
+#ifdef __unix__
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return usage.ru_maxrss;
+#endif
+	return 0;
+}
 
 class stats {
 	std::string algorithm;
@@ -21,12 +62,22 @@ class stats {
 	double totalCost;
 	unsigned int totalSteps;
 	std::vector<TimePointPair> timePoints;
-	std::vector<unsigned int> nodeVisited;
+	std::vector<ThreadStats> threadStats;
+	// allocations done before the query, see arena.h
+	unsigned long long startAllocationCount;
+	unsigned long long startAllocatedBytes;
 
 public:
 	stats(const std::string &algorithm, unsigned int nThreads, const std::string &inputFile, unsigned long seed)
-			: algorithm(algorithm), nThreads(nThreads), inputFile(inputFile), seed(seed) {
-		nodeVisited = std::vector<unsigned int>(nThreads, 0);
+			: algorithm(algorithm), nThreads(nThreads), inputFile(inputFile), seed(seed), threadStats(nThreads) {
+		for (auto &ts: threadStats) {
+			std::fill_n(ts.counters, N_COUNTERS, 0);
+			ts.heapPeak = 0;
+		}
+		// time steps of a query are few, reserve them so that they are not counted as allocations of the query
+		timePoints.reserve(16);
+		startAllocationCount = allocation_count();
+		startAllocatedBytes = allocated_bytes();
 	}
 
 	void setTotalCost(double totalCost) {
@@ -38,37 +89,145 @@ public:
 	}
 
 	void addNodeVisited(NodeId threadId) {
-		nodeVisited[threadId]++;
+		threadStats[threadId].counters[COUNTER_EXPANDED]++;
 	}
 
-	void timeStep(const std::string &stepName) {
+	void addCounter(NodeId threadId, Counter counter, unsigned long long n = 1) {
+		threadStats[threadId].counters[counter] += n;
+	}
+
+	// Total of a counter over all the threads
+	unsigned long long getCounter(Counter counter) const {
+		unsigned long long total = 0;
+		for (auto &ts: threadStats)
+			total += ts.counters[counter];
+		return total;
+	}
+
+	// Track the maximum size reached by the open set of the thread
+	void updateHeapPeak(NodeId threadId, unsigned long long heapSize) {
+		if (heapSize > threadStats[threadId].heapPeak)
+			threadStats[threadId].heapPeak = heapSize;
+	}
+
+	// Start hardware counters for the calling thread, should be called by the thread itself
+	void startPerfCounters(NodeId threadId) {
+		threadStats[threadId].perfCounters.start();
+	}
+
+	void stopPerfCounters(NodeId threadId) {
+		threadStats[threadId].perfCounters.stop();
+	}
+
+	void timeStep(std::string_view stepName) {
 		timePoints.emplace_back(TimePointPair(high_resolution_clock::now(), stepName));
 	}
 
 	void printTimeStats() {
-		for(int i = 1; i < timePoints.size(); i++) {
+		for (unsigned int i = 1; i < timePoints.size(); i++) {
 			std::cout << timePoints[i].second << ": " << duration_cast<duration<double>>(timePoints[i].first - timePoints[i - 1].first).count() << " seconds." << std::endl;
 		}
 	}
 
+	// Print counters of every thread, useful to check the load balance
+	void printThreadStats() {
+		for (unsigned int t = 0; t < nThreads; t++) {
+			std::cout << "Thread " << t << ":";
+			for (int c = 0; c < N_COUNTERS; c++)
+				std::cout << " " << counterNames[c] << " " << threadStats[t].counters[c] << ",";
+			std::cout << " heap peak " << threadStats[t].heapPeak << std::endl;
+		}
+#ifdef COUNT_ALLOCATIONS
+		std::cout << "Allocations: " << getAllocations() << " (" << getAllocatedBytes() << " bytes)" << std::endl;
+#endif
+	}
+
+	// Allocations done since the stats were created, 0 without COUNT_ALLOCATIONS
+	unsigned long long getAllocations() const {
+		return allocation_count() - startAllocationCount;
+	}
+
+	unsigned long long getAllocatedBytes() const {
+		return allocated_bytes() - startAllocatedBytes;
+	}
+
+	// Header of AstarReport.csv, written when the file is created. The per thread columns come after the fixed ones
+	// and hold the values of all the threads separated by '-', the path is the last column
+	static void write_csv_header(std::ostream &os) {
+		os << "algorithm,threads,input file,seed,total cost,total steps,graph read time,astar time,"
+		   << "path reconstruction time,";
+		for (int c = 0; c < N_COUNTERS; c++)
+			os << counterNames[c] << ",";
+		os << "heap peak,peak rss kb,";
+		for (int e = 0; e < PERF_N_EVENTS; e++)
+			os << perfEventNames[e] << ",";
+		os << "replan time,graph load mb/s,sequential graph read time,allocations,allocated bytes,";
+		for (int c = 0; c < N_COUNTERS; c++)
+			os << counterNames[c] << " per thread,";
+		os << "heap peak per thread,";
+		for (int e = 0; e < PERF_N_EVENTS; e++)
+			os << perfEventNames[e] << " per thread,";
+		os << "path" << std::endl;
+	}
+
 	void dump_csv(const std::vector<NodeId> &path) {
+		unsigned long long allocations = getAllocations(), bytes = getAllocatedBytes();
 		std::fstream outFile("AstarReport.csv", std::fstream::out | std::fstream::app);
-		double graphReadTime = 0, astarTime = 0, pathRecTime = 0;
-		for (int i = 1; i < timePoints.size(); i++) {
+		outFile.seekp(0, std::ios::end);
+		if (outFile.tellp() == 0)
+			write_csv_header(outFile);
+		// the graph is read once before the first run, so every run reports the same read time
+		double graphReadTime = graphLoadInfo.seconds, astarTime = 0, pathRecTime = 0, replanTime = 0;
+		for (unsigned int i = 1; i < timePoints.size(); i++) {
 			if (timePoints[i].second == "Read graph")
 				graphReadTime = duration_cast<duration<double>>(timePoints[i].first - timePoints[i - 1].first).count();
-			else if (timePoints[i].second == "Astar")
-				astarTime = duration_cast<duration<double>>(timePoints[i].first - timePoints[i - 1].first).count();
+			else if (timePoints[i].second == "Astar") // summed, a search can have more phases (hybrid_astar)
+				astarTime += duration_cast<duration<double>>(timePoints[i].first - timePoints[i - 1].first).count();
 			else if (timePoints[i].second == "Path reconstruction")
 				pathRecTime = duration_cast<duration<double>>(timePoints[i].first - timePoints[i - 1].first).count();
+			else if (timePoints[i].second == "Replan")
+				replanTime = duration_cast<duration<double>>(timePoints[i].first - timePoints[i - 1].first).count();
+		}
+
+		// merge thread counters
+		unsigned long long totals[N_COUNTERS] = {0};
+		unsigned long long heapPeak = 0;
+		unsigned long long perfTotals[PERF_N_EVENTS] = {0};
+		for (auto &ts: threadStats) {
+			for (int c = 0; c < N_COUNTERS; c++)
+				totals[c] += ts.counters[c];
+			heapPeak = std::max(heapPeak, ts.heapPeak);
+			for (int e = 0; e < PERF_N_EVENTS; e++)
+				perfTotals[e] += ts.perfCounters.get((PerfEvent) e);
 		}
-		unsigned int totalNodeVisited = std::reduce(nodeVisited.begin(), nodeVisited.end());
+
 		outFile << algorithm << "," << nThreads << "," << inputFile << "," << seed << "," << totalCost << ","
-				<< totalSteps << "," << graphReadTime << "," << astarTime << "," << pathRecTime << "," << totalNodeVisited << ",";
-		int i;
-		for (i = 0; i < path.size() - 1; i++)
-			outFile << path[i] << "-";
-		outFile << path[i] <<  std::endl;
+				<< totalSteps << "," << graphReadTime << "," << astarTime << "," << pathRecTime << ","
+				<< totals[COUNTER_EXPANDED] << ",";
+		// totals of the other counters, max heap size and hardware counters
+		for (int c = 1; c < N_COUNTERS; c++)
+			outFile << totals[c] << ",";
+		outFile << heapPeak << "," << peak_rss_kb() << ",";
+		for (int e = 0; e < PERF_N_EVENTS; e++)
+			outFile << perfTotals[e] << ",";
+		outFile << replanTime << ",";
+		outFile << (graphLoadInfo.seconds > 0 ? graphLoadInfo.bytes / 1e6 / graphLoadInfo.seconds : 0) << ",";
+		outFile << graphLoadInfo.sequentialSeconds << ",";
+		outFile << allocations << "," << bytes << ",";
+		// per thread values of every counter, separated by '-'
+		for (int c = 0; c < N_COUNTERS; c++) {
+			for (unsigned int t = 0; t < nThreads; t++)
+				outFile << threadStats[t].counters[c] << (t < nThreads - 1 ? "-" : ",");
+		}
+		for (unsigned int t = 0; t < nThreads; t++)
+			outFile << threadStats[t].heapPeak << (t < nThreads - 1 ? "-" : ",");
+		for (int e = 0; e < PERF_N_EVENTS; e++) {
+			for (unsigned int t = 0; t < nThreads; t++)
+				outFile << threadStats[t].perfCounters.get((PerfEvent) e) << (t < nThreads - 1 ? "-" : ",");
+		}
+		for (unsigned int i = 0; i < path.size(); i++)
+			outFile << path[i] << (i < path.size() - 1 ? "-" : "");
+		outFile << std::endl;
 		outFile.close();
 	}
 };
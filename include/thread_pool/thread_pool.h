@@ -0,0 +1,75 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../affinity/affinity.h"
+
+// Threads kept across queries: starting a std::thread allocates its state, so the engines start their threads once
+// and run every search on them. run(f) calls f(threadId) on every thread and returns when all of them are done.
+// f is passed to the threads as a function pointer and a pointer to it, since std::function could allocate.
+// With NUMA_AWARE every thread is pinned to its cpu once, when it starts
+class thread_pool {
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable startCv, doneCv;
+	unsigned long long generation = 0;
+	unsigned int running = 0;
+	bool stopping = false;
+	void (*task)(void *, unsigned int) = nullptr;
+	void *taskContext = nullptr;
+
+	void worker(unsigned int threadId) {
+		pin_thread(threadId);
+		unsigned long long done = 0;
+		while (true) {
+			void (*t)(void *, unsigned int);
+			void *context;
+			{
+				std::unique_lock lock(mutex);
+				startCv.wait(lock, [&] { return stopping || generation != done; });
+				if (stopping)
+					return;
+				done = generation;
+				t = task;
+				context = taskContext;
+			}
+			t(context, threadId);
+			std::unique_lock lock(mutex);
+			if (--running == 0)
+				doneCv.notify_one();
+		}
+	}
+
+public:
+	explicit thread_pool(unsigned int nThreads) {
+		for (unsigned int t = 0; t < nThreads; t++)
+			threads.emplace_back(&thread_pool::worker, this, t);
+	}
+
+	~thread_pool() {
+		{
+			std::unique_lock lock(mutex);
+			stopping = true;
+		}
+		startCv.notify_all();
+		for (auto &t: threads)
+			t.join();
+	}
+
+	template<typename F>
+	void run(F &f) {
+		std::unique_lock lock(mutex);
+		task = [](void *context, unsigned int threadId) { (*static_cast<F *>(context))(threadId); };
+		taskContext = &f;
+		running = threads.size();
+		generation++;
+		startCv.notify_all();
+		doneCv.wait(lock, [&] { return running == 0; });
+	}
+};
+
+#endif
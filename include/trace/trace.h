@@ -0,0 +1,133 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Per thread event tracer, exported in the Chrome trace event format (open with chrome://tracing or
+// https://ui.perfetto.dev). Everything is compiled out unless ENABLE_TRACE is defined.
+//
+// Usage:
+//   TRACE_INIT(nThreads)             reset the buffers before a run
+//   TRACE_SCOPE(threadId, "name")    record the duration of the enclosing scope
+//   TRACE_SPAN(threadId, "name")     as TRACE_SCOPE, but if the last event of the thread has the same name and ends
+//                                    where this scope starts, it is extended up to the end of this scope instead of
+//                                    recording a new one. Used for the scopes entered on every iteration (e.g. node
+//                                    expansions), so that the buffer holds more of the search
+//   TRACE_DUMP(filename)             write the recorded events as JSON
+
+#ifdef ENABLE_TRACE
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// events kept for each thread, older events are overwritten when the buffer is full
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 65536
+#endif
+
+// two spans touch if the second starts at most this many ns after the end of the first, the time of reading the clock
+// and of popping the next node between two expansions. A run of pruned pops, an idle wait or anything traced in between
+// (e.g. a drain of the message queue) leaves a gap, and the spans stay separate
+#ifndef TRACE_MERGE_GAP_NS
+#define TRACE_MERGE_GAP_NS 200
+#endif
+
+typedef struct {
+	const char *name;
+	long long start; // ns from trace start
+	long long duration; // ns
+} TraceEvent;
+
+// Each thread writes only its own buffer, aligned to avoid false sharing with the neighbours
+typedef struct alignas(64) {
+	std::vector<TraceEvent> events;
+	unsigned long long count; // total events recorded, events[count % TRACE_BUFFER_SIZE] is the next slot
+} TraceBuffer;
+
+std::vector<TraceBuffer> traceBuffers;
+std::chrono::steady_clock::time_point traceStart;
+
+void trace_init(unsigned int nThreads) {
+	traceBuffers = std::vector<TraceBuffer>(nThreads);
+	for (auto &b: traceBuffers) {
+		b.events = std::vector<TraceEvent>(TRACE_BUFFER_SIZE);
+		b.count = 0;
+	}
+	traceStart = std::chrono::steady_clock::now();
+}
+
+long long trace_now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+}
+
+void trace_record(unsigned int threadId, const char *name, long long start, long long end, bool merge = false) {
+	TraceBuffer &b = traceBuffers[threadId];
+	if (merge && b.count > 0) {
+		TraceEvent &last = b.events[(b.count - 1) % TRACE_BUFFER_SIZE];
+		// names are compared by value, the same literal can have more addresses
+		if (start - (last.start + last.duration) <= TRACE_MERGE_GAP_NS && strcmp(last.name, name) == 0) {
+			last.duration = end - last.start;
+			return;
+		}
+	}
+	b.events[b.count % TRACE_BUFFER_SIZE] = TraceEvent{.name = name, .start = start, .duration = end - start};
+	b.count++;
+}
+
+void trace_dump(const std::string &filename) {
+	std::fstream outFile(filename, std::fstream::out | std::fstream::trunc);
+	outFile << "{\"traceEvents\":[" << std::endl;
+	bool first = true;
+	for (unsigned int t = 0; t < traceBuffers.size(); t++) {
+		outFile << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << t
+		        << R"(,"args":{"name":"worker )" << t << "\"}}";
+		first = false;
+		TraceBuffer &b = traceBuffers[t];
+		unsigned long long begin = b.count > TRACE_BUFFER_SIZE ? b.count - TRACE_BUFFER_SIZE : 0;
+		for (unsigned long long i = begin; i < b.count; i++) {
+			TraceEvent &e = b.events[i % TRACE_BUFFER_SIZE];
+			// timestamps are in microseconds
+			outFile << ",\n" << R"({"name":")" << e.name << R"(","ph":"X","pid":0,"tid":)" << t << ",\"ts\":"
+			        << (double) e.start / 1000 << ",\"dur\":" << (double) e.duration / 1000 << "}";
+		}
+		if (begin > 0)
+			std::cerr << "trace: thread " << t << " dropped " << begin << " events" << std::endl;
+	}
+	outFile << std::endl << "]}" << std::endl;
+	outFile.close();
+}
+
+class trace_scope {
+	unsigned int threadId;
+	const char *name;
+	long long start;
+	bool merge;
+
+public:
+	trace_scope(unsigned int threadId, const char *name, bool merge = false)
+			: threadId(threadId), name(name), start(trace_now()), merge(merge) {}
+
+	~trace_scope() {
+		trace_record(threadId, name, start, trace_now(), merge);
+	}
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_INIT(nThreads) trace_init(nThreads)
+#define TRACE_SCOPE(threadId, name) trace_scope TRACE_CONCAT(traceScope, __LINE__)(threadId, name)
+#define TRACE_SPAN(threadId, name) trace_scope TRACE_CONCAT(traceScope, __LINE__)(threadId, name, true)
+#define TRACE_DUMP(filename) trace_dump(filename)
+
+#else
+
+#define TRACE_INIT(nThreads) ((void) 0)
+#define TRACE_SCOPE(threadId, name) ((void) 0)
+#define TRACE_SPAN(threadId, name) ((void) 0)
+#define TRACE_DUMP(filename) ((void) 0)
+
+#endif
+
+#endif
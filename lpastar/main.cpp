@@ -0,0 +1,329 @@
+#include <queue>
+#include <iostream>
+#include <cfloat>
+#include <map>
+#include <fstream>
+#include <iomanip>
+#include <utility>
+
+#include "../include/graph_utils/graph_utils.h"
+#include "../include/stats/stats.h"
+#include "../include/dynamic_weights/dynamic_weights.h"
+#include "../include/query_cache/query_cache.h"
+
+// edge weights are multiplied by a random factor in [1, MAX_TRAFFIC_FACTOR] of their original weight, so that the
+// heuristic stays admissible
+#define MAX_TRAFFIC_FACTOR 3
+
+// the euclidean distance is scaled down by this factor to keep the heuristic consistent with the weights of the graph
+// files: they are rounded to 6 decimals (an error up to 5e-7) while the coordinates are integers, at distance >= 1
+#define LPASTAR_H_SCALE (1 - 1e-6)
+
+// number of (source, dest) pairs kept in the query cache, 0 disables it
+#ifndef QUERY_CACHE_SIZE
+#define QUERY_CACHE_SIZE 0
+#endif
+
+#ifdef QUERY_CACHE_SUBPATHS
+#define QUERY_CACHE_SUBPATH_REUSE true
+#else
+#define QUERY_CACHE_SUBPATH_REUSE false
+#endif
+
+using namespace boost;
+
+
+/** types **/
+
+// LPA* keys are compared lexicographically: [min(g, rhs) + h, min(g, rhs)]
+typedef std::pair<double, double> Key;
+
+typedef struct {
+	Key key;
+	NodeId node;
+} NodeKey;
+
+const auto queue_comparator = [](const NodeKey &a, const NodeKey &b) { return a.key > b.key; };
+typedef std::priority_queue<NodeKey, std::vector<NodeKey>, decltype(queue_comparator)> OpenSet;
+
+
+/** functions **/
+
+// Lifelong Planning A* (Koenig, Likhachev, Furcy). The costs of the previous search are kept, so that after some
+// edge weights change only the nodes whose cost to come is affected are expanded again.
+// The open set uses lazy deletion: a node is pushed again every time its key changes and outdated entries are
+// skipped when popped.
+// The batches of weight updates are applied by the planner itself, before a query and between two expansions, so that
+// the updates received while a search is running are repaired by the same search
+class lpastar {
+	Graph &g;
+	weight_updates &updates;
+	NodeId source, target;
+	std::vector<double> gCost;
+	std::vector<double> rhs; // one step lookahead of gCost
+	std::vector<NodeId> cameFrom;
+	OpenSet openSet;
+	std::vector<WeightUpdate> applied; // updates applied since the last take_applied
+
+	Key calculate_key(NodeId n) {
+		double m = std::min(gCost[n], rhs[n]);
+		return Key(m == DBL_MAX ? DBL_MAX : m + LPASTAR_H_SCALE * calc_h_cost(g, n, target), m);
+	}
+
+	void push_if_inconsistent(NodeId n) {
+		if (gCost[n] != rhs[n])
+			openSet.push(NodeKey{.key = calculate_key(n), .node = n});
+	}
+
+	// recompute rhs of n from all its neighbors
+	void update_vertex(NodeId n) {
+		if (n != source) {
+			rhs[n] = DBL_MAX;
+			cameFrom[n] = INVALID_NODE_ID;
+			for (auto e: make_iterator_range(out_edges(n, g))) {
+				if (gCost[e.m_target] == DBL_MAX)
+					continue;
+				double cost = gCost[e.m_target] + get(edge_weight, g, e);
+				if (cost < rhs[n]) {
+					rhs[n] = cost;
+					cameFrom[n] = e.m_target;
+				}
+			}
+		}
+		push_if_inconsistent(n);
+	}
+
+public:
+	lpastar(Graph &g, weight_updates &updates, NodeId source, NodeId target)
+			: g(g), updates(updates), source(source), target(target), openSet(queue_comparator) {
+		unsigned int N = num_vertices(g);
+		gCost = std::vector<double>(N, DBL_MAX);
+		rhs = std::vector<double>(N, DBL_MAX);
+		cameFrom = std::vector<NodeId>(N, INVALID_NODE_ID);
+		rhs[source] = 0;
+		push_if_inconsistent(source);
+	}
+
+	// Notify the change of the weight of the edge between a and b
+	void update_edge(NodeId a, NodeId b) {
+		update_vertex(a);
+		update_vertex(b);
+	}
+
+	// Write the updates pushed since the last call on the graph and update the endpoints of the changed edges
+	void apply_updates() {
+		if (!updates.has_pending())
+			return;
+		auto &batch = updates.apply_pending(g);
+		for (auto &u: batch)
+			update_edge(u.source, u.target);
+		applied.insert(applied.end(), batch.begin(), batch.end());
+	}
+
+	// Updates applied since the last call, before the query or during its search
+	std::vector<WeightUpdate> take_applied() {
+		return std::exchange(applied, {});
+	}
+
+	void compute_shortest_path(stats &s) {
+		while (true) {
+			apply_updates();
+			if (openSet.empty())
+				break;
+			NodeKey top = openSet.top();
+			NodeId curr = top.node;
+			// skip outdated entries
+			if (gCost[curr] == rhs[curr] || top.key != calculate_key(curr)) {
+				openSet.pop();
+				continue;
+			}
+			if (!(top.key < calculate_key(target)) && rhs[target] == gCost[target])
+				break;
+			openSet.pop();
+
+			s.addNodeVisited(0);
+			if (gCost[curr] > rhs[curr]) {
+				// overconsistent: the cost decreased, propagate it to the neighbors
+				gCost[curr] = rhs[curr];
+				for (auto e: make_iterator_range(out_edges(curr, g))) {
+					NodeId n = e.m_target;
+					double cost = gCost[curr] + get(edge_weight, g, e);
+					if (n != source && cost < rhs[n]) {
+						rhs[n] = cost;
+						cameFrom[n] = curr;
+						push_if_inconsistent(n);
+					}
+				}
+			} else {
+				// underconsistent: the cost increased, the neighbors that came from this node must be recomputed
+				gCost[curr] = DBL_MAX;
+				update_vertex(curr);
+				for (auto e: make_iterator_range(out_edges(curr, g))) {
+					if (cameFrom[e.m_target] == curr)
+						update_vertex(e.m_target);
+				}
+			}
+		}
+	}
+
+	std::pair<double, std::vector<NodeId>> reconstruct_path() {
+		std::vector<NodeId> path;
+		if (gCost[target] == DBL_MAX)
+			return std::make_pair(-1, path);
+		for (NodeId curr = target; curr != source; curr = cameFrom[curr]) {
+			if (curr == INVALID_NODE_ID) {
+				std::cerr << "lpastar: Error during path reconstruction: Node parent not found" << std::endl;
+				return std::make_pair(-1, std::vector<NodeId>());
+			}
+			path.emplace_back(curr);
+		}
+		path.emplace_back(source);
+		std::reverse(path.begin(), path.end());
+		return std::make_pair(gCost[target], path);
+	}
+};
+
+unsigned long lcg_next(unsigned long &seed) {
+	seed = seed * LCG_MULTIPLIER + LCG_INCREMENT;
+	return seed;
+}
+
+// Simulate a batch of traffic updates: half of the edges are chosen on the current path, so that the path has to be
+// repaired, the other half are random edges of the graph
+std::vector<WeightUpdate> random_traffic(const Graph &g, unsigned long &seed, const std::vector<NodeId> &path,
+                                         unsigned int nUpdates, std::map<std::pair<NodeId, NodeId>, double> &freeFlow) {
+	std::vector<WeightUpdate> batch;
+	unsigned int N = num_vertices(g);
+	for (unsigned int i = 0; i < nUpdates; i++) {
+		NodeId a, b;
+		if (i % 2 == 0 && path.size() > 1) {
+			unsigned long j = lcg_next(seed) % (path.size() - 1);
+			a = path[j];
+			b = path[j + 1];
+		} else {
+			a = lcg_next(seed) % N;
+			if (out_degree(a, g) == 0)
+				continue;
+			auto e = *std::next(out_edges(a, g).first, (long) (lcg_next(seed) % out_degree(a, g)));
+			b = e.m_target;
+		}
+		auto key = std::make_pair(std::min(a, b), std::max(a, b));
+		if (!freeFlow.contains(key))
+			freeFlow[key] = get(edge_weight, g, edge(a, b, g).first);
+		double factor = 1 + (double) (lcg_next(seed) % 1000) / 1000 * (MAX_TRAFFIC_FACTOR - 1);
+		batch.emplace_back(WeightUpdate{.source = a, .target = b, .weight = freeFlow[key] * factor});
+	}
+	return batch;
+}
+
+// Append the updates applied before a replan to LpastarUpdates.csv, so that the optimal cost on the updated weights
+// can be checked (scripts/differential_test.py). Weights are written with full precision
+void log_updates(unsigned long seed, unsigned int repetition, const std::vector<WeightUpdate> &applied) {
+	std::fstream outFile("LpastarUpdates.csv", std::fstream::out | std::fstream::app);
+	outFile << std::setprecision(17);
+	for (auto &u: applied)
+		outFile << seed << "," << repetition << "," << u.source << "," << u.target << "," << u.weight << std::endl;
+	outFile.close();
+}
+
+int main(int argc, char *argv[]) {
+	// print usage
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " FILENAME STARTING_SEED [N_SEEDS=1] [N_REPS=1] [N_UPDATES=10]"
+		          << std::endl;
+		return 1;
+	}
+
+	// parse command line parameters
+	char *filename = argv[1];
+	unsigned long seed;
+	unsigned int nSeeds = 1;
+	unsigned int nReps = 1;
+	unsigned int nUpdates = 10;
+	try {
+		seed = std::stoul(argv[2]);
+		if (argc >= 4)
+			nSeeds = std::stoul(argv[3]);
+		if (argc >= 5)
+			nReps = std::stoul(argv[4]);
+		if (argc >= 6)
+			nUpdates = std::stoul(argv[5]);
+	} catch (std::invalid_argument const &e) {
+		std::cerr << "Invalid command line parameter" << std::endl;
+		return 2;
+	}
+
+	// read graph
+	Graph g = load_graph(filename);
+	unsigned int N = num_vertices(g);
+
+	NodeId source, dest;
+	weight_updates updates;
+	std::map<std::pair<NodeId, NodeId>, double> freeFlow;
+	query_cache cache(QUERY_CACHE_SIZE, QUERY_CACHE_SUBPATH_REUSE);
+
+	// monte carlo simulation: for every seed plan the path, then repair it after nReps batches of updates
+	for (unsigned int k = 0; k < nSeeds; k++) {
+		unsigned int local_seed = seed;
+		randomize_source_dest(seed, N, source, dest);
+		unsigned long traffic_seed = seed;
+		lpastar planner(g, updates, source, dest);
+
+		for (unsigned int i = 0; i <= nReps; i++) {
+			stats s(i == 0 ? "LPA*" : "LPA* Replan", 1, filename, local_seed);
+			std::cerr << "Repetition " << k << ", " << i << std::endl;
+			s.timeStep("Start");
+
+			if (i > 0) {
+				// apply the updates received since the last query, the previous path is repaired below together with
+				// the updates received during the search
+				planner.apply_updates();
+				s.timeStep("Apply updates");
+			}
+
+			// the cached paths that may not be optimal on the updated weights are dropped before the lookup, and the ones
+			// affected by the updates received during the search before the repaired path is inserted
+			std::vector<WeightUpdate> applied = planner.take_applied();
+			cache.invalidate(applied);
+			std::pair<double, std::vector<NodeId>> path_pair;
+			if (cache.lookup(source, dest, path_pair.first, path_pair.second)) {
+				s.timeStep(i > 0 ? "Replan" : "Astar");
+			} else {
+				planner.compute_shortest_path(s);
+				s.timeStep(i > 0 ? "Replan" : "Astar");
+				std::vector<WeightUpdate> appliedDuringSearch = planner.take_applied();
+				cache.invalidate(appliedDuringSearch);
+				applied.insert(applied.end(), appliedDuringSearch.begin(), appliedDuringSearch.end());
+				path_pair = planner.reconstruct_path();
+				if (path_pair.first >= 0)
+					cache.insert(g, path_pair.first, path_pair.second);
+			}
+			log_updates(local_seed, i, applied);
+			if (path_pair.first < 0)
+				break;
+			s.timeStep("Path reconstruction");
+			s.printTimeStats();
+
+			std::cout << "Total cost: " << path_pair.first << std::endl;
+			std::cout << "Total steps: " << path_pair.second.size() << std::endl;
+
+			s.setTotalCost(path_pair.first);
+			s.setTotalSteps(path_pair.second.size());
+			s.dump_csv(path_pair.second);
+
+			// traffic received while the path is followed, applied before the next query
+			updates.push(random_traffic(g, traffic_seed, path_pair.second, nUpdates, freeFlow));
+		}
+
+		// restore the original weights before the next seed
+		for (auto &w: freeFlow)
+			updates.push(WeightUpdate{.source = w.first.first, .target = w.first.second, .weight = w.second});
+		cache.invalidate(updates.apply_pending(g));
+		freeFlow.clear();
+	}
+
+	if (cache.enabled())
+		cache.print_stats(std::cout);
+
+	return 0;
+}
@@ -0,0 +1,571 @@
+import csv
+import os
+import sys
+import random
+import signal
+import math
+import heapq
+import socket
+import subprocess
+import tempfile
+import time
+
+# Differential test of the parallel versions against sequential_astar.
+# Random graphs are generated with graph_generation, then every engine solves the same seeded queries and the cost of
+# each path (recomputed from the graph file) is compared with the optimal cost found by sequential_astar.
+# The paths repaired by lpastar after its traffic updates are compared with Dijkstra on the updated weights, read
+# from LpastarUpdates.csv.
+# grid_astar runs on random MovingAI maps of about GRAPH_SIZE cells, its A* and JPS paths are compared with Dijkstra on
+# the same grid.
+# With a build configured with ENABLE_TSAN=ON the data races reported by ThreadSanitizer are counted too, e.g.:
+#   cmake -S SDP-Astar/ -B build_tsan/ -DCMAKE_BUILD_TYPE=RelWithDebInfo -DENABLE_TSAN=ON
+#   python differential_test.py build_tsan/ 3 1000 1234 2000
+# The engines of other builds (e.g. with QUERY_CACHE_SIZE or SOA_GRAPH) can be checked in the same run by passing
+# their build folders after GRAPH_SIZE, BUILD_DIR is used to generate the graphs and compute the expected paths.
+# Those variants are compile options, so they are covered by their builds and not by separate engines.
+# The exit code is 1 if any engine returned a worse or invalid path, missed a query or had a race
+
+# number of batches of traffic updates (N_REPS) and updates per batch applied by lpastar to every query
+LPASTAR_REPS = 3
+LPASTAR_UPDATES = 10
+# queries solved by a single run for the "repeated" oracle. randomize_source_dest soon repeats the same queries, so
+# that the query cache (QUERY_CACHE_SIZE) answers most of them from whole paths or suffixes and evicts entries
+REPEATED_QUERIES = 500
+
+# (name, executable, parameters after STARTING_SEED, oracle, query cache hits expected)
+# oracle "astar": cost of the path compared with the sequential_astar optimum on the weights of the graph file
+# oracle "lpastar": cost of the path of each repetition compared with Dijkstra on the updated weights
+# oracle "repeated": a single run from the first seed, each query compared with Dijkstra
+# oracle "server": queries sent to astar_server, compared with Dijkstra
+# oracle "grid": the A* and JPS paths of grid_astar on a map with uniform costs, compared with Dijkstra on the grid
+# oracle "weighted grid": the A* paths of grid_astar on a map with weighted cells, compared with Dijkstra on the grid
+# With the query cache enabled, the engines answering the same queries more times must have cache hits
+engines = [
+    # compared with itself in BUILD_DIR, with the sequential_astar of the other builds otherwise
+    ("sequential_astar", "sequential_astar", ["1", "1"], "astar", False),
+    ("sequential_astar (repeated)", "sequential_astar", [str(REPEATED_QUERIES), "1"], "repeated", True),
+    ("hdastar_shared", "hdastar_shared", ["1", "1"], "astar", False),
+    ("hdastar_message_passing", "hdastar_message_passing", ["1", "1"], "astar", False),
+    ("delta_stepping", "delta_stepping", ["1", "1"], "astar", False),
+    # small node budget, so that most queries escalate to HDA* from the sequential frontier
+    ("hybrid_astar (escalated)", "hybrid_astar", ["1", "1", "100"], "astar", False),
+    # short probe, so that the queries not on track to end within the budget escalate after a few expansions
+    ("hybrid_astar (probed)", "hybrid_astar", ["1", "1", "60", "inf", "20"], "astar", False),
+    # distance threshold 0, every query is solved by HDA* from the source
+    ("hybrid_astar (parallel)", "hybrid_astar", ["1", "1", "10000", "0"], "astar", False),
+    # half of every batch of updates is on the path of the query, which is dropped from the query cache
+    ("lpastar", "lpastar", ["1", str(LPASTAR_REPS), str(LPASTAR_UPDATES)], "lpastar", False),
+    # without updates the repetitions are answered by the query cache
+    ("lpastar (no updates)", "lpastar", ["1", str(LPASTAR_REPS), "0"], "lpastar", True),
+    # every query, then every query again and the suffixes of the paths, sent to a running server
+    ("astar_server", "astar_server", [], "server", True),
+    # jump point search runs only on 8-connected maps with uniform costs, A* alone on the others
+    ("grid_astar", "grid_astar", ["1", "1", "8"], "grid", False),
+    ("grid_astar (weighted)", "grid_astar", ["1", "1", "8"], "weighted grid", False),
+    ("grid_astar (weighted, 4-connected)", "grid_astar", ["1", "1", "4"], "weighted grid", False),
+]
+
+# randomize_source_dest of graph_utils.h
+LCG_MULTIPLIER = 22695477
+LCG_INCREMENT = 1
+
+# AstarReport.csv columns, by name in the header
+ALGORITHM = "algorithm"
+SEED = "seed"
+TOTAL_COST = "total cost"
+PATH = "path"
+
+# relative difference between two path costs considered equal, the weights are written with 6 decimals
+TOLERANCE = 1e-9
+# seconds before a run (a single query) is considered deadlocked
+RUN_TIMEOUT = 600
+
+# fraction of blocked cells of the random maps, and draws of grid_astar to find two free cells
+# (MAX_SOURCE_DEST_ATTEMPTS)
+GRID_BLOCKED = 0.25
+GRID_SOURCE_DEST_ATTEMPTS = 1000
+# algorithm of the AstarReport.csv rows of grid_astar, and the suffix of the engine name
+GRID_ALGORITHMS = {"Grid A*": "A*", "Grid JPS": "JPS"}
+
+tsan_suppressions = os.path.join(os.path.dirname(os.path.abspath(__file__)), "tsan_suppressions.txt")
+
+
+def generate_graph(working_dir, graph_seed):
+    # same default k as graph_generation, it must be passed to pass the seed
+    k = math.ceil(2 * math.e * math.log(GRAPH_SIZE))
+    side = math.ceil(10 * math.sqrt(GRAPH_SIZE))
+    subprocess.run([os.path.join(build_dirs[0], "graph_generation"), str(side), str(GRAPH_SIZE), str(k), str(graph_seed)],
+                   cwd=working_dir, stderr=subprocess.DEVNULL, check=True)
+    return os.path.join(working_dir, "k-neargraph_%d_%d_%d_1.txt" % (side, GRAPH_SIZE, k))
+
+
+# Random MovingAI map of about GRAPH_SIZE cells, wider than high so that swapped coordinates do not go unnoticed. The
+# weighted maps mix the costs 1-9 with the other free and blocked characters of the format
+def generate_grid(working_dir, grid_seed, weighted):
+    rng = random.Random(grid_seed)
+    width = math.ceil(math.sqrt(2 * GRAPH_SIZE))
+    height = math.ceil(GRAPH_SIZE / width)
+    free, blocked = (".GS123456789", "@OTW") if weighted else (".", "@")
+    map_file = os.path.join(working_dir, "grid_%s.map" % ("weighted" if weighted else "uniform"))
+    with open(map_file, "w") as f:
+        f.write("type octile\nheight %d\nwidth %d\nmap\n" % (height, width))
+        for _ in range(height):
+            f.write("".join(rng.choice(blocked) if rng.random() < GRID_BLOCKED else rng.choice(free)
+                            for _ in range(width)) + "\n")
+    return map_file
+
+
+# Cost of every cell of a map as read by read_grid_map, 0 if blocked, and the width of the map
+def read_grid(map_file):
+    header = {}
+    with open(map_file) as f:
+        for line in f:
+            if line.strip() == "map":
+                break
+            key, value = line.split()
+            header[key] = value
+        width, height = int(header["width"]), int(header["height"])
+        cells = []
+        for _ in range(height):
+            line = f.readline().rstrip("\n")[:width].ljust(width, "@")
+            cells += [1 if c in ".GS" else int(c) if c in "123456789" else 0 for c in line]
+    return cells, width
+
+
+def read_weights(graph_file):
+    weights = {}
+    with open(graph_file) as f:
+        n = int(f.readline())
+        for _ in range(n):
+            f.readline()
+        for line in f:
+            fields = line.split()
+            if len(fields) == 3:
+                a, b, w = int(fields[0]), int(fields[1]), float(fields[2])
+                weights[(a, b)] = weights[(b, a)] = min(w, weights.get((a, b), math.inf))
+    return weights
+
+
+# Cost of a path computed from the graph, None if two consecutive nodes are not adjacent
+def path_cost(weights, path):
+    cost = 0
+    for a, b in zip(path, path[1:]):
+        if (a, b) not in weights:
+            return None
+        cost += weights[(a, b)]
+    return cost
+
+
+def adjacency_lists(weights):
+    adjacency = {}
+    for (a, b), w in weights.items():
+        adjacency.setdefault(a, []).append(b)
+    return adjacency
+
+
+# Edges of a grid like grid_graph::for_each_neighbor: a step costs its length times the average cost of the two
+# cells, and a diagonal step needs both the orthogonal cells free
+def grid_weights(cells, width, connectivity):
+    height = len(cells) // width
+
+    def cost(x, y):
+        return cells[y * width + x] if 0 <= x < width and 0 <= y < height else 0
+
+    steps = [(1, 0), (-1, 0), (0, 1), (0, -1)]
+    if connectivity == 8:
+        steps += [(1, 1), (1, -1), (-1, 1), (-1, -1)]
+    weights = {}
+    for y in range(height):
+        for x in range(width):
+            c = cost(x, y)
+            for dx, dy in steps:
+                d = cost(x + dx, y + dy)
+                if c and d and cost(x + dx, y) and cost(x, y + dy):
+                    step = math.sqrt(2) if dx and dy else 1
+                    weights[(y * width + x, (y + dy) * width + x + dx)] = step * (c + d) / 2
+    return weights
+
+
+# Same source and dest chosen by randomize_source_dest, returns the seed for the next query too
+def source_dest(query_seed, nodes):
+    r1 = (query_seed * LCG_MULTIPLIER + LCG_INCREMENT) % 2 ** 64 % nodes
+    r2 = (r1 * LCG_MULTIPLIER + LCG_INCREMENT) % 2 ** 64 % nodes
+    return r1, r2
+
+
+# Same free source and dest cells chosen by grid_astar, None if it gives up
+def grid_source_dest(query_seed, cells):
+    for _ in range(GRID_SOURCE_DEST_ATTEMPTS):
+        source, dest = source_dest(query_seed, len(cells))
+        if cells[source] and cells[dest]:
+            return source, dest
+        query_seed = dest
+    return None
+
+
+def dijkstra(adjacency, weights, source, dest):
+    distance = {source: 0}
+    heap = [(0, source)]
+    while heap:
+        d, n = heapq.heappop(heap)
+        if n == dest:
+            return d
+        if d > distance[n]:
+            continue
+        for m in adjacency.get(n, []):
+            w = weights[(n, m)]
+            if d + w < distance.get(m, math.inf):
+                distance[m] = d + w
+                heapq.heappush(heap, (d + w, m))
+    return None
+
+
+# Run an executable once for every query seed and return the rows of AstarReport.csv with a path as
+# [(seed, path)], the lines of the other csv files written by the runs, the lines of stdout, the exit codes and the
+# number of races.
+# randomize_source_dest reduces the seed modulo the number of nodes, so a single run with N_SEEDS queries would soon
+# repeat the same few queries: every query is a separate run from its own starting seed instead, unless single_run.
+# With by_algorithm the rows are [(algorithm, seed, path)], for the executables running more algorithms per query
+def run(build_dir, executable, parameters, graph_file, single_run=False, by_algorithm=False):
+    returncodes = set()
+    with tempfile.TemporaryDirectory() as working_dir:
+        env = dict(os.environ)
+        env["TSAN_OPTIONS"] = (env.get("TSAN_OPTIONS", "") + " suppressions=" + tsan_suppressions).strip()
+        with open(os.path.join(working_dir, "stderr.txt"), "w+") as err, \
+                open(os.path.join(working_dir, "stdout.txt"), "w+") as out:
+            for query_seed in query_seeds[:1] if single_run else query_seeds:
+                try:
+                    returncodes.add(subprocess.run([os.path.join(build_dir, executable), graph_file, str(query_seed)]
+                                                   + parameters, cwd=working_dir, env=env, stdout=out, stderr=err,
+                                                   timeout=RUN_TIMEOUT).returncode)
+                except subprocess.TimeoutExpired:
+                    returncodes.add("timeout")
+            err.seek(0)
+            races = sum(1 for line in err if "WARNING: ThreadSanitizer" in line)
+            out.seek(0)
+            stdout = [line.strip() for line in out]
+        rows = []
+        csv_files = {}
+        for filename in os.listdir(working_dir):
+            if filename.endswith(".csv") and filename != "AstarReport.csv":
+                with open(os.path.join(working_dir, filename)) as f:
+                    csv_files[filename] = [line.strip().split(",") for line in f if line.strip()]
+        report_file = os.path.join(working_dir, "AstarReport.csv")
+        if os.path.exists(report_file):
+            with open(report_file) as report:
+                for row in csv.DictReader(report):
+                    # runs without a path have a negative cost, a run killed while writing leaves a shorter row
+                    if row[PATH] is not None and float(row[TOTAL_COST]) >= 0:
+                        path = [int(n) for n in row[PATH].split("-") if n]
+                        rows.append((row[ALGORITHM], int(row[SEED]), path) if by_algorithm else (int(row[SEED]), path))
+    returncodes.discard(0)
+    return rows, csv_files, stdout, returncodes, races
+
+
+# Compare a path with the optimal cost of the same query
+def check(t, name, label, weights, path, source, dest, optimal):
+    cost = path_cost(weights, path)
+    t["queries"] += 1
+    if cost is None or path[0] != source or path[-1] != dest:
+        t["invalid paths"] += 1
+        return
+    deviation = (cost - optimal) / optimal if optimal else 0
+    t["max deviation"] = max(t["max deviation"], deviation)
+    t["deviation sum"] += deviation
+    if abs(deviation) > TOLERANCE:
+        t["mismatches"] += 1
+        print("  %s: %s cost %.9g, optimal %.9g" % (name, label, cost, optimal))
+
+
+def check_astar(t, name, rows):
+    results = dict(rows)
+    # queries without a path are not in the report, they must be missing for both
+    t["missing"] += len(set(expected) ^ set(results))
+    for query_seed, optimal_path in expected.items():
+        if query_seed in results:
+            check(t, name, "seed %d" % query_seed, weights, results[query_seed], optimal_path[0], optimal_path[-1],
+                  path_cost(weights, optimal_path))
+
+
+# Every lpastar run plans the query, then repairs it after each batch of updates: the rows of a seed are the
+# repetitions in order, and the weights of repetition i are the original ones with the batches 1..i applied
+def check_lpastar(t, name, rows, updates):
+    repetitions = {}
+    for query_seed, path in rows:
+        repetitions.setdefault(query_seed, []).append(path)
+    batches = {}
+    for u in updates:
+        batches.setdefault((int(u[0]), int(u[1])), []).append((int(u[2]), int(u[3]), float(u[4])))
+    t["missing"] += len(set(expected) ^ set(repetitions))
+    for query_seed, optimal_path in expected.items():
+        if query_seed not in repetitions:
+            continue
+        source, dest = optimal_path[0], optimal_path[-1]
+        t["missing"] += LPASTAR_REPS + 1 - len(repetitions[query_seed])
+        current = dict(weights)
+        for i, path in enumerate(repetitions[query_seed]):
+            for a, b, w in batches.get((query_seed, i), []):
+                current[(a, b)] = current[(b, a)] = w
+            optimal = path_cost(weights, optimal_path) if i == 0 else dijkstra(adjacency, current, source, dest)
+            check(t, name, "seed %d repetition %d" % (query_seed, i), current, path, source, dest, optimal)
+
+
+# A single run solves the chain of queries of randomize_source_dest from the first seed, in order. Queries are
+# repeated, so every row is checked in the order of the chain. The entries the query cache needs to hold all the
+# distinct paths are added to t["working sets"], as (without subpaths, with subpaths)
+def check_repeated(t, name, rows):
+    distinct = {}
+    for _, path in rows:
+        distinct[(path[0], path[-1])] = len(path)
+    t.setdefault("working sets", []).append((len(distinct), sum(1 + max(n - 2, 0) for n in distinct.values())))
+    optimal = {}
+    next_row = 0
+    query_seed = query_seeds[0]
+    for _ in range(REPEATED_QUERIES):
+        source, dest = source_dest(query_seed, GRAPH_SIZE)
+        if (source, dest) not in optimal:
+            optimal[(source, dest)] = dijkstra(adjacency, weights, source, dest)
+        if optimal[(source, dest)] is not None:
+            if next_row < len(rows) and rows[next_row][0] == query_seed:
+                check(t, name, "seed %d" % query_seed, weights, rows[next_row][1], source, dest,
+                      optimal[(source, dest)])
+                next_row += 1
+            else:
+                t["missing"] += 1
+        query_seed = dest
+    t["missing"] += len(rows) - next_row
+
+
+# Statistics of the query cache printed by the runs, summed in t["cache"]. The line is
+# "Query cache: capacity C, subpaths on|off, H hits, S subpath hits, M misses, I invalidations, E evictions, hit rate R"
+# and is printed only when the cache is enabled. The runs answering the same queries more times must have hits
+def add_cache_stats(t, stdout):
+    for line in stdout:
+        # astar_server answers STATS also without cache
+        if line.startswith("Query cache:") and not line.startswith("Query cache: capacity 0,"):
+            cache = t.setdefault("cache", {})
+            for field in line[len("Query cache:"):].split(","):
+                words = field.split()
+                if words[0].isdigit():
+                    cache[" ".join(words[1:])] = cache.get(" ".join(words[1:]), 0) + int(words[0])
+                elif words[0] in ["capacity", "subpaths"]:
+                    cache[words[0]] = words[1]
+
+
+def check_cache_used(t, name):
+    if "cache" not in t:
+        return
+    cache = t["cache"]
+    print("  %s: query cache %s" % (name, ", ".join("%s %s" % (key, value) for key, value in cache.items())))
+    # the chain of queries is a cycle: when its paths do not fit in the cache, the least recently used path evicted
+    # is always the next one asked, and there can be no hits
+    working_set = 1 if cache["subpaths"] == "on" else 0
+    if all(sizes[working_set] > int(cache["capacity"]) for sizes in t.get("working sets", [(0, 0)])):
+        print("  %s: the paths of the queries need more than %s entries, hits not required" % (name, cache["capacity"]))
+        return
+    if cache["hits"] + cache["subpath hits"] == 0:
+        t["failed runs"] += 1
+        print("  %s: the query cache had no hits" % name)
+    # astar_server is also asked the suffixes of the paths and more distinct queries than the capacity
+    if name.endswith("astar_server"):
+        if cache["subpaths"] == "on" and cache["subpath hits"] == 0:
+            t["failed runs"] += 1
+            print("  %s: no query answered from a suffix" % name)
+        if t["distinct queries"] > int(cache["capacity"]) and cache["evictions"] == 0:
+            t["failed runs"] += 1
+            print("  %s: no evictions" % name)
+
+
+# Start astar_server and ask every query, then again every query followed by the query from the middle node of its
+# path to dest, which the query cache can answer from whole paths and suffixes. Returns [(query, path)], the statistics
+# printed in reply to STATS, the exit code and the number of races
+def run_server(build_dir, graph_file):
+    results = []
+    with tempfile.TemporaryDirectory() as working_dir:
+        env = dict(os.environ)
+        env["TSAN_OPTIONS"] = (env.get("TSAN_OPTIONS", "") + " suppressions=" + tsan_suppressions).strip()
+        address = os.path.join(working_dir, "server.sock")
+        with open(os.path.join(working_dir, "stderr.txt"), "w+") as err:
+            server = subprocess.Popen([os.path.join(build_dir, "astar_server"), graph_file, address, "4"],
+                                      cwd=working_dir, env=env, stdout=subprocess.DEVNULL, stderr=err)
+            start = time.time()
+            while not os.path.exists(address) and server.poll() is None and time.time() - start < RUN_TIMEOUT:
+                time.sleep(0.01)
+            stats = []
+            if server.poll() is None:
+                client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                client.settimeout(RUN_TIMEOUT)
+                client.connect(address)
+                lines = client.makefile("r")
+                lines.readline()  # NODES
+
+                def ask(queries):
+                    client.sendall("".join("%d %d %d\n" % (i, a, b) for i, (a, b) in enumerate(queries)).encode())
+                    paths = {}
+                    for _ in queries:
+                        fields = lines.readline().split()
+                        paths[int(fields[0])] = [int(n) for n in fields[3].split("-")] if len(fields) > 3 else None
+                    for i, query in enumerate(queries):
+                        results.append((query, paths[i]))
+                    return paths
+
+                queries = [source_dest(query_seed, GRAPH_SIZE) for query_seed in query_seeds]
+                first = ask(queries)
+                # most recently solved first, so that the paths still in the cache are asked before being evicted
+                again = []
+                for i in reversed(range(len(queries))):
+                    again.append(queries[i])
+                    if first[i]:
+                        again.append((first[i][len(first[i]) // 2], first[i][-1]))
+                ask(again)
+                client.sendall(b"STATS\n")
+                stats = [lines.readline()[len("STATS "):].strip()]
+                client.close()
+                server.terminate()
+            try:
+                server.wait(timeout=RUN_TIMEOUT)
+            except subprocess.TimeoutExpired:
+                server.kill()
+                server.wait()
+            err.seek(0)
+            races = sum(1 for line in err if "WARNING: ThreadSanitizer" in line)
+    return results, stats, server.returncode, races
+
+
+def check_server(t, name, results):
+    t["distinct queries"] = t.get("distinct queries", 0) + len(set(query for query, _ in results))
+    for (source, dest), path in results:
+        optimal = dijkstra(adjacency, weights, source, dest)
+        if (optimal is None) != (path is None):
+            t["missing"] += 1
+        elif path is not None:
+            check(t, name, "query %d-%d" % (source, dest), weights, path, source, dest, optimal)
+
+
+# name of the totals of an algorithm of grid_astar, e.g. "grid_astar (weighted, A*)"
+def grid_engine_name(name, algorithm):
+    return name[:-1] + ", %s)" % algorithm if name.endswith(")") else "%s (%s)" % (name, algorithm)
+
+
+# grid_astar writes a row per algorithm for every query with a path, each compared with Dijkstra on the grid. The
+# optimal costs are computed once for all the builds. The first algorithm is counted in t, the others in their own
+# totals, and an algorithm that should not run on the map is a failed run
+def check_grid(t, name, rows, grid, algorithms):
+    results = {}
+    for algorithm, query_seed, path in rows:
+        results.setdefault(GRID_ALGORITHMS.get(algorithm, algorithm), {})[query_seed] = path
+    for algorithm in set(results) - set(algorithms):
+        t["failed runs"] += 1
+        print("  %s: unexpected %s paths" % (name, algorithm))
+    for algorithm in algorithms:
+        t_algorithm = t if algorithm == algorithms[0] else engine_totals(grid_engine_name(name, algorithm))
+        paths = results.get(algorithm, {})
+        for query_seed in query_seeds:
+            if query_seed not in grid["optimal"]:
+                query = grid_source_dest(query_seed, grid["cells"])
+                optimal = dijkstra(grid["adjacency"], grid["weights"], *query) if query else None
+                grid["optimal"][query_seed] = (query, optimal)
+            query, optimal = grid["optimal"][query_seed]
+            if (optimal is None) != (query_seed not in paths):
+                t_algorithm["missing"] += 1
+            elif optimal is not None:
+                check(t_algorithm, grid_engine_name(name, algorithm), "seed %d" % query_seed, grid["weights"],
+                      paths[query_seed], query[0], query[1], optimal)
+
+
+if len(sys.argv) < 2:
+    print("USAGE: python differential_test.py BUILD_DIR [N_GRAPHS=3] [N_QUERIES=1000] [SEED=1234] [GRAPH_SIZE=2000] "
+          "[OTHER_BUILD_DIR...]")
+    sys.exit(1)
+
+build_dirs = [os.path.abspath(d) for d in [sys.argv[1]] + sys.argv[6:]]
+N_GRAPHS = int(sys.argv[2]) if len(sys.argv) > 2 else 3
+N_QUERIES = int(sys.argv[3]) if len(sys.argv) > 3 else 1000
+seed = int(sys.argv[4]) if len(sys.argv) > 4 else 1234
+GRAPH_SIZE = int(sys.argv[5]) if len(sys.argv) > 5 else 2000
+
+
+# engines of the other builds are prefixed by the name of their folder
+def label(build_dir, name):
+    return name if build_dir == build_dirs[0] else "%s: %s" % (os.path.basename(build_dir), name)
+
+
+totals = {}
+
+
+def engine_totals(name):
+    return totals.setdefault(name, {"queries": 0, "mismatches": 0, "invalid paths": 0, "missing": 0, "races": 0,
+                                    "failed runs": 0, "max deviation": 0.0, "deviation sum": 0.0})
+
+
+for graph_index in range(N_GRAPHS):
+    with tempfile.TemporaryDirectory() as graph_dir:
+        graph_file = generate_graph(graph_dir, seed + graph_index)
+        weights = read_weights(graph_file)
+        adjacency = adjacency_lists(weights)
+        query_seeds = range(seed + graph_index * N_QUERIES, seed + (graph_index + 1) * N_QUERIES)
+        expected_rows, _, _, _, _ = run(build_dirs[0], "sequential_astar", ["1", "1"], graph_file)
+        expected = dict(expected_rows)
+        print("graph %d: %d nodes, %d queries with a path" % (graph_index, GRAPH_SIZE, len(expected)))
+        # maps of grid_astar, with the edges of each connectivity built when first needed
+        map_files = {oracle: generate_grid(graph_dir, seed + graph_index, oracle == "weighted grid")
+                     for oracle in ["grid", "weighted grid"]}
+        grids = {}
+
+        for build_dir in build_dirs:
+            for name, executable, parameters, oracle, cache_hits in engines:
+                if build_dir == build_dirs[0] and (executable, parameters) == ("sequential_astar", ["1", "1"]):
+                    continue
+                name = label(build_dir, name)
+                if oracle.endswith("grid"):
+                    connectivity = int(parameters[2])
+                    if (oracle, connectivity) not in grids:
+                        cells, width = read_grid(map_files[oracle])
+                        grid_edges = grid_weights(cells, width, connectivity)
+                        grids[(oracle, connectivity)] = {"cells": cells, "weights": grid_edges,
+                                                         "adjacency": adjacency_lists(grid_edges), "optimal": {}}
+                    algorithms = ["A*", "JPS"] if oracle == "grid" and connectivity == 8 else ["A*"]
+                    t = engine_totals(grid_engine_name(name, algorithms[0]))
+                else:
+                    t = engine_totals(name)
+                if oracle == "server":
+                    results, stdout, returncode, races = run_server(build_dir, graph_file)
+                    returncodes = {returncode} - {0, -signal.SIGTERM}
+                elif oracle.endswith("grid"):
+                    rows, _, stdout, returncodes, races = run(build_dir, executable, parameters, map_files[oracle],
+                                                              by_algorithm=True)
+                else:
+                    rows, csv_files, stdout, returncodes, races = run(build_dir, executable, parameters, graph_file,
+                                                                      oracle == "repeated")
+                t["races"] += races
+                if returncodes:
+                    t["failed runs"] += 1
+                    print("  %s: exit codes %s" % (name, ", ".join(str(code) for code in returncodes)))
+                if oracle == "lpastar":
+                    check_lpastar(t, name, rows, csv_files.get("LpastarUpdates.csv", []))
+                elif oracle == "repeated":
+                    check_repeated(t, name, rows)
+                elif oracle == "server":
+                    check_server(t, name, results)
+                elif oracle.endswith("grid"):
+                    check_grid(t, name, rows, grids[(oracle, connectivity)], algorithms)
+                else:
+                    check_astar(t, name, rows)
+                if cache_hits:
+                    add_cache_stats(t, stdout)
+
+for name, t in totals.items():
+    check_cache_used(t, name)
+
+print()
+print("%-44s %8s %10s %8s %8s %6s %7s %14s %14s" % ("engine", "queries", "mismatches", "invalid", "missing", "races",
+                                                   "failed", "max deviation", "avg deviation"))
+failed = False
+for name, t in totals.items():
+    average = t["deviation sum"] / t["queries"] if t["queries"] else 0
+    print("%-44s %8d %10d %8d %8d %6d %7d %14.3g %14.3g" % (name, t["queries"], t["mismatches"], t["invalid paths"],
+                                                           t["missing"], t["races"], t["failed runs"],
+                                                           t["max deviation"], average))
+    failed |= any(t[key] for key in ["mismatches", "invalid paths", "missing", "races", "failed runs"])
+
+sys.exit(1 if failed else 0)
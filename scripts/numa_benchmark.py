@@ -0,0 +1,51 @@
+import csv
+import os
+import sys
+import subprocess
+import tempfile
+
+# Compare the HDA* versions built without and with NUMA_AWARE.
+# Both builds should be configured with ENABLE_PERF_COUNTERS=ON to collect the remote memory accesses, e.g.:
+#   cmake -S SDP-Astar/ -B build/ -DCMAKE_BUILD_TYPE=Release -DENABLE_PERF_COUNTERS=ON
+#   cmake -S SDP-Astar/ -B build_numa/ -DCMAKE_BUILD_TYPE=Release -DENABLE_PERF_COUNTERS=ON -DNUMA_AWARE=ON
+#   python numa_benchmark.py build/ build_numa/ newyork.txt 1234 10 3
+
+executables = ["hdastar_shared", "hdastar_message_passing"]
+
+# AstarReport.csv columns, by name in the header
+ASTAR_TIME = "astar time"
+PERF_COLUMNS = ["cycles", "LLC misses", "NUMA node misses"]
+
+
+def run(build_dir, executable):
+    with tempfile.TemporaryDirectory() as working_dir:
+        process = subprocess.Popen([os.path.join(os.path.abspath(build_dir), executable), input_file, str(seed),
+                                    str(N_SEEDS), str(N_REPS)], cwd=working_dir, stdout=subprocess.DEVNULL)
+        process.wait()
+        with open(os.path.join(working_dir, "AstarReport.csv")) as report:
+            rows = list(csv.DictReader(report))
+    results = {"A* time (s)": sum(float(r[ASTAR_TIME]) for r in rows) / len(rows)}
+    for name in PERF_COLUMNS:
+        results[name] = sum(int(r[name]) for r in rows) / len(rows)
+    return results
+
+
+if len(sys.argv) < 5:
+    print("USAGE: python numa_benchmark.py BASELINE_BUILD_DIR NUMA_BUILD_DIR INPUT_FILE SEED [N_SEEDS=5] [N_REPS=3]")
+    sys.exit(1)
+
+baseline_dir = sys.argv[1]
+numa_dir = sys.argv[2]
+input_file = os.path.abspath(sys.argv[3])
+seed = int(sys.argv[4])
+N_SEEDS = int(sys.argv[5]) if len(sys.argv) > 5 else 5
+N_REPS = int(sys.argv[6]) if len(sys.argv) > 6 else 3
+
+for executable in executables:
+    before = run(baseline_dir, executable)
+    after = run(numa_dir, executable)
+    print(executable)
+    print("  %-20s %16s %16s %8s" % ("average per run", "baseline", "NUMA aware", "ratio"))
+    for key in before:
+        ratio = after[key] / before[key] if before[key] else 0
+        print("  %-20s %16.6g %16.6g %7.3fx" % (key, before[key], after[key], ratio))
@@ -1,88 +1,24 @@
 #include <iostream>
 #include <utility>
-#include <queue>
-#include <cfloat> // Needed to use DBL_MAX
 
+#include "../include/astar/astar_sequential.h"
 #include "../include/graph_utils/graph_utils.h"
 #include "../include/stats/stats.h"
+#include "../include/query_cache/query_cache.h"
+#include "../include/soa_graph/soa_graph.h"
 
-using namespace boost;
-
-typedef std::pair<unsigned int, double> NodeFCost;
-
-// Reconstruct path from graph and list of costs to nodes
-std::pair<double, std::vector<unsigned int>>
-reconstruct_path(const Graph &g, unsigned int source, unsigned int target, const NodeId *cameFrom,
-                 const double *costToCome, const stats &s) {
-	std::vector<unsigned int> path;
-	path.emplace_back(target);
-	unsigned int current = target;
-	while (current != source) {
-		if (cameFrom[current] == INVALID_NODE_ID) {
-			std::cerr << "sequential_astar: Error during path reconstruction: Node " << current << " parent not found"
-			          << std::endl;
-			return std::make_pair(-1, path);
-		}
-		current = cameFrom[current];
-		path.insert(path.begin(), current);
-	}
-	double ret = costToCome[target];
-	return std::make_pair(ret, path);
-}
-
-// Find the best path from source to target node. Prints the results on file
-std::pair<double, std::vector<unsigned int>>
-astar_sequential(const Graph &g, unsigned int source, unsigned int target, stats &s) {
-	auto comp = [](NodeFCost a, NodeFCost b) { return a.second > b.second; };
-	std::priority_queue<NodeFCost, std::vector<NodeFCost>, decltype(comp)> openSet;
-	std::set<unsigned int> closedSet;
-	unsigned long long V = num_vertices(g);
-	double *costToCome = new double[V];
-	std::fill_n(costToCome, V, DBL_MAX);
-	NodeId *cameFrom = new NodeId[V];
-	std::fill_n(cameFrom, V, INVALID_NODE_ID);
-
-	costToCome[source] = 0;
-	openSet.push(NodeFCost(source, 0));
-
-	while (!openSet.empty()) {
-		NodeFCost curr_pair = openSet.top();
-		unsigned int curr = curr_pair.first;
-		openSet.pop();
-		if (curr == target) {
-			s.timeStep("Astar");
-			// Reconstructing path
-			auto path = reconstruct_path(ref(g), source, target, cameFrom, costToCome, ref(s));
-			s.timeStep("Path reconstruction");
-
-			delete[] costToCome;
-			delete[] cameFrom;
-
-			return path;
-		}
-		if (closedSet.find(curr) != closedSet.end())
-			continue;
-		closedSet.insert(curr);
-		s.addNodeVisited(0);
-		for (auto e: make_iterator_range(out_edges(curr, g))) {
-			auto edge_w = get(edge_weight, g, e);
-			if (closedSet.find(e.m_target) != closedSet.end())
-				continue;
-			double gCost = costToCome[curr] + edge_w;
-			double fCost = gCost + calc_h_cost(g, e.m_target, target);
-			if (gCost > costToCome[e.m_target])
-				continue;
-			cameFrom[e.m_target] = curr;
-			costToCome[e.m_target] = gCost;
-			openSet.push(NodeFCost(e.m_target, fCost));
-		}
-	}
+// number of (source, dest) pairs kept in the query cache, 0 disables it
+#ifndef QUERY_CACHE_SIZE
+#define QUERY_CACHE_SIZE 0
+#endif
 
-	delete[] costToCome;
-	delete[] cameFrom;
+#ifdef QUERY_CACHE_SUBPATHS
+#define QUERY_CACHE_SUBPATH_REUSE true
+#else
+#define QUERY_CACHE_SUBPATH_REUSE false
+#endif
 
-	return std::make_pair(-1, std::vector<unsigned int>());
-}
+using namespace boost;
 
 int main(int argc, char *argv[]) {
 	// print usage
@@ -108,15 +44,28 @@ int main(int argc, char *argv[]) {
 	}
 
 	// read graph
-	Graph g = read_graph(filename);
+	Graph g = load_graph(filename);
 	unsigned int N = num_vertices(g);
+#ifdef SOA_GRAPH
+	// structure of arrays copy used by the search, g is still used by the query cache
+	soa_graph searchGraph(g);
+	std::cout << "Relax kernel: " << searchGraph.kernel_name() << std::endl;
+	if (const char *wrongKernel = searchGraph.check_kernels()) {
+		std::cerr << "The " << wrongKernel << " relax kernel disagrees with the scalar one" << std::endl;
+		return 4;
+	}
+#else
+	const Graph &searchGraph = g;
+#endif
 
 	NodeId source, dest;
+	// the graph never changes, so every query uses version 0
+	query_cache cache(QUERY_CACHE_SIZE, QUERY_CACHE_SUBPATH_REUSE);
 
 	// monte carlo simulation
-	for (int k = 0; k < nSeeds; k++) {
+	for (unsigned int k = 0; k < nSeeds; k++) {
 		unsigned int local_seed = seed;
-		for (int i = 0; i < nReps; i++) {
+		for (unsigned int i = 0; i < nReps; i++) {
 			stats s("A*", 1, filename, local_seed);
 
 			// randomize seed every nReps runs
@@ -126,7 +75,15 @@ int main(int argc, char *argv[]) {
 			std::cerr << "Repetition " << k << ", " << i << std::endl;
 			s.timeStep("Start");
 
-			auto path_pair = astar_sequential(ref(g), source, dest, ref(s));
+			std::pair<double, std::vector<unsigned int>> path_pair;
+			if (cache.lookup(source, dest, path_pair.first, path_pair.second)) {
+				s.timeStep("Astar");
+				s.timeStep("Path reconstruction");
+			} else {
+				path_pair = astar_sequential(searchGraph, source, dest, euclidean_heuristic(), s);
+				if (path_pair.first >= 0)
+					cache.insert(g, path_pair.first, path_pair.second);
+			}
 			auto path_weight = path_pair.first;
 			auto path = path_pair.second;
 
@@ -146,5 +103,8 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
+	if (cache.enabled())
+		cache.print_stats(std::cout);
+
 	return 0;
 }